@@ -6,12 +6,12 @@ layout(location = 0) in struct {
     float samplerid;
 } In;
 
-layout(binding = 0) uniform sampler3D u_FontAtlasTextures;
-//layout(binding = 0) uniform sampler2DArray u_FontAtlasTextures;
+// Glyph cache pages, samplerid is the page (array layer)
+layout(binding = 0) uniform sampler2DArray u_GlyphPages;
 
 layout(location = 0) out vec4 fragColor;
 
 void main()
 {
-    fragColor = vec4(texture(u_FontAtlasTextures, vec3(In.texCoord.xy, In.samplerid)).r) * In.color;
+    fragColor = vec4(texture(u_GlyphPages, vec3(In.texCoord.xy, In.samplerid)).r) * In.color;
 }
\ No newline at end of file
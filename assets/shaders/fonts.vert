@@ -1,9 +1,12 @@
 #version 450
 
-layout(location = 0) in vec3 a_Position;
-layout(location = 1) in vec4 a_Color;
-layout(location = 2) in vec2 a_TexCoord;
-layout(location = 3) in float a_SamplerID;
+// One instance per glyph, expanded to two triangles from gl_VertexIndex
+layout(location = 0) in vec2 a_Center;
+layout(location = 1) in vec2 a_Size;
+layout(location = 2) in vec4 a_UV;
+layout(location = 3) in vec4 a_Color;
+layout(location = 4) in float a_Rotation;
+layout(location = 5) in uint a_Layer;
 
 layout(location = 0) out struct {
     vec4 color;
@@ -17,11 +20,23 @@ layout(push_constant) uniform PushConstant
     mat4 model;
 } u_PC;
 
+const vec2 c_Corners[6] = vec2[](
+    vec2( 1.0,  1.0), vec2(-1.0,  1.0), vec2(-1.0, -1.0),
+    vec2( 1.0,  1.0), vec2(-1.0, -1.0), vec2( 1.0, -1.0)
+);
+
 void main()
 {
-    gl_Position = u_PC.projection_view * u_PC.model * vec4(a_Position, 1.0);
+    vec2 corner = c_Corners[gl_VertexIndex];
+
+    float s = sin(a_Rotation);
+    float c = cos(a_Rotation);
+    vec2 local = corner * a_Size * 0.5;
+    vec2 position = a_Center + vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+
+    gl_Position = u_PC.projection_view * u_PC.model * vec4(position, 0.0, 1.0);
 
     Out.color = a_Color;
-    Out.texCoord = a_TexCoord;
-    Out.samplerid = a_SamplerID;
+    Out.texCoord = mix(a_UV.xy, a_UV.zw, corner * 0.5 + 0.5);
+    Out.samplerid = float(a_Layer);
 }
\ No newline at end of file
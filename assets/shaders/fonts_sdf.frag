@@ -0,0 +1,23 @@
+#version 450
+
+layout(location = 0) in struct {
+    vec4 color;
+    vec2 texCoord;
+    float samplerid;
+} In;
+
+// Glyph cache pages holding signed distance fields, 0.5 is the outline, samplerid is the page (array layer)
+layout(binding = 0) uniform sampler2DArray u_GlyphPages;
+
+layout(location = 0) out vec4 fragColor;
+
+void main()
+{
+    float distance = texture(u_GlyphPages, vec3(In.texCoord.xy, In.samplerid)).r;
+
+    // Antialias over about one screen pixel whatever the glyph scale
+    float edge = max(fwidth(distance) * 0.5, 1e-4);
+    float coverage = smoothstep(0.5 - edge, 0.5 + edge, distance);
+
+    fragColor = vec4(coverage) * In.color;
+}
@@ -0,0 +1,16 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec4 i_color;
+layout(location = 1) in vec2 i_texCoord;
+layout(location = 2) flat in uint i_texture;
+
+// Every image Renderer2D draws, indexed by the instance's texture slot
+layout(binding = 0) uniform sampler2D u_Images[];
+
+layout(location = 0) out vec4 fragColor;
+
+void main()
+{
+    fragColor = texture(u_Images[nonuniformEXT(i_texture)], i_texCoord) * i_color;
+}
\ No newline at end of file
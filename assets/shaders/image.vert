@@ -0,0 +1,34 @@
+#version 450
+
+// One instance per image quad, expanded to two triangles from gl_VertexIndex
+layout(location = 0) in vec2 a_Position;
+layout(location = 1) in vec2 a_Size;
+layout(location = 2) in vec4 a_Color;
+layout(location = 3) in uint a_Texture;
+
+layout(location = 0) out vec4 o_color;
+layout(location = 1) out vec2 o_texCoord;
+layout(location = 2) flat out uint o_texture;
+
+layout(push_constant) uniform PushConstant
+{
+    mat4 projection_view;
+    mat4 model;
+} u_PC;
+
+const vec2 c_Corners[6] = vec2[](
+    vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0),
+    vec2(1.0, 1.0), vec2(0.0, 0.0), vec2(1.0, 0.0)
+);
+
+void main()
+{
+    vec2 corner = c_Corners[gl_VertexIndex];
+    vec2 position = a_Position + corner * a_Size;
+
+    gl_Position = u_PC.projection_view * u_PC.model * vec4(position, 0.0, 1.0);
+
+    o_color = a_Color;
+    o_texCoord = corner;
+    o_texture = a_Texture;
+}
\ No newline at end of file
@@ -1,7 +1,9 @@
 #version 450
 
-layout(location = 0) in vec3 a_Position;
-layout(location = 1) in vec4 a_Color;
+// One instance per rectangle, expanded to two triangles from gl_VertexIndex
+layout(location = 0) in vec2 a_Position;
+layout(location = 1) in vec2 a_Size;
+layout(location = 2) in vec4 a_Color;
 
 layout(location = 0) out vec4 o_color;
 
@@ -11,9 +13,16 @@ layout(push_constant) uniform PushConstant
     mat4 model;
 } u_PC;
 
+const vec2 c_Corners[6] = vec2[](
+    vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0),
+    vec2(1.0, 1.0), vec2(0.0, 0.0), vec2(1.0, 0.0)
+);
+
 void main()
 {
-    gl_Position = u_PC.projection_view * u_PC.model * vec4(a_Position, 1.0);
+    vec2 position = a_Position + c_Corners[gl_VertexIndex] * a_Size;
+
+    gl_Position = u_PC.projection_view * u_PC.model * vec4(position, 0.0, 1.0);
 
     o_color = a_Color;
 }
\ No newline at end of file
@@ -24,7 +24,8 @@ namespace saf {
 
     void DebugLayer::Render(std::shared_ptr<Renderer2D> renderer)
     {
-
+        m_LayoutCacheStats = renderer->GetLayoutCacheStats();
+        m_FrameStats = renderer->GetFrameStats();
     }
 
     int printFPS() {
@@ -49,6 +50,13 @@ namespace saf {
     {
         ImGui::Begin("Debug");
         ImGui::Text("FPS: %d", printFPS());
+        ImGui::Text("Frame: %.2f ms, %.2f ms jitter, %.2f ms worst, %u missed", m_FramePacerStats.frame_ms, m_FramePacerStats.jitter_ms, m_FramePacerStats.worst_ms, m_FramePacerStats.missed);
+        ImGui::Text("Pacing: %.2f ms asleep, %.3f ms spinning", m_FramePacerStats.sleep_ms, m_FramePacerStats.spin_ms);
+        ImGui::Text("Layout cache: %llu hits, %llu misses, %zu entries", static_cast<unsigned long long>(m_LayoutCacheStats.hits), static_cast<unsigned long long>(m_LayoutCacheStats.misses), m_LayoutCacheStats.entries);
+        ImGui::Text("Instances: %u glyphs, %u rects, %.1f KiB written per frame", m_FrameStats.glyph_instances, m_FrameStats.rect_instances, m_FrameStats.instance_bytes / 1024.0);
+        ImGui::Text("Instance chunks: %u glyph, %u rect, %u image, %.1f KiB staging", m_FrameStats.glyph_chunks, m_FrameStats.rect_chunks, m_FrameStats.image_chunks, m_FrameStats.staging_bytes / 1024.0);
+        ImGui::Text("Images: %u drawn, %u slots", m_FrameStats.image_instances, m_FrameStats.image_slots);
+        ImGui::Text("Draws: %u commands, %u draw calls, %u pipeline binds, %u buffer binds", m_FrameStats.commands, m_FrameStats.draw_calls, m_FrameStats.pipeline_binds, m_FrameStats.buffer_binds);
         ImGui::End();
     }
 
@@ -70,7 +78,7 @@ namespace saf {
         m_Input = std::make_shared<Input>();
         global::g_Input = m_Input;
         m_Renderer2D = std::make_shared<Renderer2D>();
-        m_FrameManager = std::make_unique<FrameManager>(m_Window->GetWidth(), m_Window->GetHeight());
+        m_FrameManager = std::make_unique<FrameManager>(m_Window->GetWidth(), m_Window->GetHeight(), GetUIntArgument(args, "framesinflight", FrameManager::s_DefaultFramesInFlight));
 
         m_Projection2D = glm::mat4(1.f);
         float left = 0.f, right = static_cast<float>(m_Window->GetWidth());
@@ -93,15 +101,36 @@ namespace saf {
     {
         IFX_INFO("Application Init");
 
+        // -pacing uncapped | cap | present, -maxfps <fps> for cap
+        FramePacing pacing = FramePacing::Capped;
+        if (m_RunArgs.contains("pacing"))
+        {
+            const std::string mode = m_RunArgs["pacing"].is_string() ? m_RunArgs["pacing"].get<std::string>() : "";
+            if (mode == "uncapped") pacing = FramePacing::Uncapped;
+            else if (mode == "cap") pacing = FramePacing::Capped;
+            else if (mode == "present") pacing = FramePacing::Present;
+            else IFX_ERROR("-pacing expects uncapped, cap or present, got {0}", m_RunArgs["pacing"].dump());
+        }
+        m_FramePacer.Configure(pacing, GetUIntArgument(m_RunArgs, "maxfps", 60));
+        m_FrameManager->SetVsync(pacing == FramePacing::Present);
+
+        // -ondemand only draws after input, a dirty or animating layer or RequestRedraw
+        m_OnDemand = m_RunArgs.contains("ondemand");
+
         m_Window->Init();
         m_FrameManager->Init();
         m_Renderer2D->Init();
+        global::g_PipelineCache->LogStats("at startup");
 
         m_Window->SetEventCallback([this](Event& e)
             {
+                m_RedrawFrames = s_SettleFrames;
+
                 EventDispatcher d(e);
                 d.Dispatch<WindowResizeEvent>([this](WindowResizeEvent& e)
                     {
+                        m_FrameManager->Resize(e.GetWidth(), e.GetHeight());
+
                         m_Projection2D = glm::mat4(1.f);
                         float left = 0.f, right = static_cast<float>(e.GetWidth());
                         float top = 0.f, bottom = static_cast<float>(e.GetHeight());
@@ -129,26 +158,36 @@ namespace saf {
 
     }
 
-    const int maxfps = 60;
-
     void GraphicsApplication::Run()
     {
         IFX_INFO("Application Run");
 
         while(!m_Window->ShouldClose() && m_Running)
         {
-            static auto oldTime = std::chrono::high_resolution_clock::now();
-            const int us = 1000000 / maxfps;
-
-            if (std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - oldTime) < std::chrono::microseconds{ us })
+            if (m_OnDemand && !WantsFrame())
             {
-                continue;
+                // Nothing to draw, sleep in the event queue. Input is handled as soon as it arrives,
+                // the pacer does not count the time asleep as a frame.
+                m_Window->Update(s_IdleWaitSeconds);
+                m_FramePacer.Idle();
             }
-            oldTime = std::chrono::high_resolution_clock::now();
+            else
+            {
+                m_FramePacer.Wait();
+                m_Window->Update();
+            }
+
+            if (m_Window->ConsumeDamage() || m_RedrawRequested.exchange(false)) m_RedrawFrames = std::max(m_RedrawFrames, 1U);
 
             Update();
-            m_Window->Update();
-            m_FrameManager->Resize(m_Window->GetWidth(), m_Window->GetHeight());
+            for (auto layer : m_Layers)
+            {
+                if (layer->IsVisible()) layer->Update();
+            }
+
+            if (m_OnDemand && !WantsFrame()) continue;
+
+            m_DebugLayer->SetFramePacerStats(m_FramePacer.GetStats());
 
             ImGui_ImplVulkan_NewFrame();
             ImGui_ImplGlfw_NewFrame();
@@ -158,17 +197,35 @@ namespace saf {
             {
                 if (layer->IsVisible())
                 {
-                    layer->Update();
                     layer->ImGuiRender();
                     layer->Render(m_Renderer2D);
                 }
+                layer->ClearDirty();
             }
 
             m_FrameManager->Render(m_Renderer2D, m_Projection2D);
+            if (m_RedrawFrames > 0) --m_RedrawFrames;
         }
 
     }
 
+    void GraphicsApplication::RequestRedraw()
+    {
+        m_RedrawRequested.store(true);
+        m_Window->Wake();
+    }
+
+    bool GraphicsApplication::WantsFrame() const
+    {
+        if (m_RedrawFrames > 0 || m_RedrawRequested.load()) return true;
+
+        for (const auto& layer : m_Layers)
+        {
+            if (layer->IsVisible() && (layer->IsDirty() || layer->IsAnimating())) return true;
+        }
+        return false;
+    }
+
     void Application::Run()
     {
         IFX_INFO("Application Run");
@@ -1,11 +1,13 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
 
 #include "nlohmann/json.hpp"
 
 #include "utils/argumentmanager.h"
 #include "core/window.h"
+#include "core/framepacer.h"
 
 #include "input/event.h"
 
@@ -23,10 +25,18 @@ namespace saf {
         inline virtual void Render(std::shared_ptr<Renderer2D> renderer) {}
         inline virtual void ImGuiRender() {}
         inline virtual bool IsVisible() { return m_Visible; }
+
+        // On demand rendering only draws when something changed. A layer that changes outside of an event
+        // marks itself dirty, one that animates returns true here for as long as it does.
+        inline virtual bool IsAnimating() const { return false; }
+        inline void MarkDirty() { m_Dirty = true; }
+        inline bool IsDirty() const { return m_Dirty; }
+        inline void ClearDirty() { m_Dirty = false; }
     protected:
         Layer() = default;
 
         bool m_Visible;
+        bool m_Dirty = true;
     };
 
     class DebugLayer : public Layer
@@ -36,7 +46,12 @@ namespace saf {
         virtual void OnEvent(saf::Event& e) override;
         virtual void Render(std::shared_ptr<Renderer2D> renderer) override;
         virtual void ImGuiRender() override;
+
+        inline void SetFramePacerStats(const FramePacerStats& stats) { m_FramePacerStats = stats; }
     private:
+        LayoutCacheStats m_LayoutCacheStats{};
+        FrameStats m_FrameStats{};
+        FramePacerStats m_FramePacerStats{};
     };
 
     class Application
@@ -74,12 +89,26 @@ namespace saf {
 
         inline void AddLayer(std::shared_ptr<Layer> layer) { m_Layers.push_back(layer); }
 
+        // Draws the next frame in on demand mode, callable from any thread
+        void RequestRedraw();
+
     protected:
         std::shared_ptr<Window> m_Window;
         std::shared_ptr<Input> m_Input;
         std::shared_ptr<Renderer2D> m_Renderer2D;
     private:
+        bool WantsFrame() const;
+
+        // Frames drawn after the last event, ImGui needs one to react to input and one to settle its layout
+        static constexpr uint32_t s_SettleFrames = 2;
+        // Longest an idle on demand loop sleeps, bounds how late a dirty flag set without RequestRedraw is seen
+        static constexpr double s_IdleWaitSeconds = 0.5;
+
         std::unique_ptr<FrameManager> m_FrameManager;
+        FramePacer m_FramePacer;
+        bool m_OnDemand = false;
+        uint32_t m_RedrawFrames = s_SettleFrames;
+        std::atomic<bool> m_RedrawRequested{ false };
 
         std::vector<std::shared_ptr<Layer>> m_Layers;
         std::shared_ptr<DebugLayer> m_DebugLayer;
@@ -1,15 +1,23 @@
 #include "safpch.h"
 #include "core/application.h"
+#include "effects/commands.h"
+#include "globals.h"
 
 extern saf::Application* CreateApplication(nlohmann::json&& arguments);
 
 int main(int argc, char** argsv)
 {
     saf::log::Init();
+    saf::global::g_JobSystem = std::make_shared<saf::JobSystem>();
 
     saf::Application* app = nullptr;
     {
         saf::ArgumentManager argsman(argc, argsv);
+        if (saf::effects::RunCommand(argsman.m_RunArguments))
+        {
+            saf::global::g_JobSystem.reset();
+            return 0;
+        }
         app = CreateApplication(std::move(argsman.m_RunArguments));
     }
 
@@ -20,5 +28,7 @@ int main(int argc, char** argsv)
 
     delete app;
 
+    saf::global::g_JobSystem.reset();
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "safpch.h"
+#include "framepacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+    #include <timeapi.h>
+#endif
+
+namespace saf {
+
+    // Spin at least this long, and never more than this long
+    static constexpr double s_MinSpinUs = 100.0;
+    static constexpr double s_MaxSpinUs = 2000.0;
+
+    static inline float Milliseconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<float, std::milli>(duration).count();
+    }
+
+    FramePacer::FramePacer(FramePacing pacing, uint32_t max_fps)
+    {
+#ifdef _WIN32
+        // The default 15.6 ms timer tick would make every sleep overshoot a 60 fps frame
+        timeBeginPeriod(1);
+#endif
+        Configure(pacing, max_fps);
+    }
+
+    FramePacer::~FramePacer()
+    {
+#ifdef _WIN32
+        timeEndPeriod(1);
+#endif
+    }
+
+    void FramePacer::Configure(FramePacing pacing, uint32_t max_fps)
+    {
+        if (pacing == FramePacing::Capped && max_fps == 0) IFX_ERROR("FramePacer capped pacing needs a max fps above 0");
+
+        m_Pacing = pacing;
+        m_MaxFps = max_fps;
+        m_Period = max_fps > 0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / max_fps)) : Clock::duration::zero();
+        m_Started = false;
+
+        const char* names[] = { "uncapped", "capped", "present driven" };
+        IFX_TRACE("FramePacer {0}, max fps {1}", names[static_cast<int>(pacing)], max_fps);
+    }
+
+    void FramePacer::Wait()
+    {
+        Clock::time_point now = Clock::now();
+        Sample sample;
+
+        if (m_Pacing == FramePacing::Capped && m_Started)
+        {
+            if (now >= m_Deadline)
+            {
+                sample.missed = now > m_Deadline;
+            }
+            else
+            {
+                const double margin_us = std::clamp(m_OversleepUs * 1.5, s_MinSpinUs, s_MaxSpinUs);
+                const Clock::time_point wake = m_Deadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::micro>(margin_us));
+                if (now < wake)
+                {
+                    std::this_thread::sleep_until(wake);
+                    const Clock::time_point woke = Clock::now();
+                    sample.sleep_ms = Milliseconds(woke - now);
+
+                    // Jumps straight up to a late wake up, decays over a few seconds once the machine is quiet again
+                    const double oversleep_us = std::chrono::duration<double, std::micro>(woke - wake).count();
+                    m_OversleepUs = std::max(oversleep_us, m_OversleepUs * 0.99);
+                    now = woke;
+                }
+
+                const Clock::time_point spin_start = now;
+                while (now < m_Deadline)
+                {
+                    std::this_thread::yield();
+                    now = Clock::now();
+                }
+                sample.spin_ms = Milliseconds(now - spin_start);
+            }
+
+            m_Deadline = now - m_Deadline > m_Period ? now + m_Period : m_Deadline + m_Period;
+        }
+        else if (m_Pacing == FramePacing::Capped)
+        {
+            m_Deadline = now + m_Period;
+        }
+
+        if (m_Started)
+        {
+            sample.frame_ms = Milliseconds(now - m_LastFrame);
+            m_Samples[m_Frames % s_StatsWindow] = sample;
+            ++m_Frames;
+        }
+
+        m_LastFrame = now;
+        m_Started = true;
+    }
+
+    FramePacerStats FramePacer::GetStats() const
+    {
+        FramePacerStats stats;
+        const uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(m_Frames, s_StatsWindow));
+        if (count == 0) return stats;
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const Sample& sample = m_Samples[i];
+            stats.frame_ms += sample.frame_ms;
+            stats.worst_ms = std::max(stats.worst_ms, static_cast<double>(sample.frame_ms));
+            stats.sleep_ms += sample.sleep_ms;
+            stats.spin_ms += sample.spin_ms;
+            stats.missed += sample.missed ? 1 : 0;
+        }
+        stats.frame_ms /= count;
+        stats.sleep_ms /= count;
+        stats.spin_ms /= count;
+
+        double variance = 0.0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const double deviation = m_Samples[i].frame_ms - stats.frame_ms;
+            variance += deviation * deviation;
+        }
+        stats.jitter_ms = std::sqrt(variance / count);
+
+        return stats;
+    }
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <stdint.h>
+
+namespace saf {
+
+    enum class FramePacing
+    {
+        Uncapped,   // next frame starts as soon as the last one is submitted
+        Capped,     // at most max_fps, the pacer sleeps between frames
+        Present     // FIFO presentation blocks until vblank, the pacer only measures
+    };
+
+    // Over the last FramePacer::s_StatsWindow frames
+    struct FramePacerStats
+    {
+        double frame_ms = 0.0;  // mean time between frame starts
+        double jitter_ms = 0.0; // standard deviation of the frame time
+        double worst_ms = 0.0;  // longest frame
+        double sleep_ms = 0.0;  // mean time asleep per frame
+        double spin_ms = 0.0;   // mean time spinning per frame
+        uint32_t missed = 0;    // frames that started after their deadline
+    };
+
+    /*
+    Paces the main loop, Wait() is called once at the top of every frame.
+
+    Capped sleeps until shortly before the deadline, then spins out the rest, so the core is idle between
+    frames but the frame still starts on time. The spin margin follows how late the OS wakes the thread
+    (a few hundred microseconds on most desktops, a scheduler tick on a busy one).
+    Deadlines advance by one period, a frame that runs late starts the next one straight away,
+    one that runs more than a period late restarts the cadence instead of bursting to catch up.
+    */
+    class FramePacer
+    {
+    public:
+        static constexpr uint32_t s_StatsWindow = 120;
+
+        FramePacer(FramePacing pacing = FramePacing::Capped, uint32_t max_fps = 60);
+        FramePacer(const FramePacer&) = delete;
+        FramePacer(FramePacer&&) = delete;
+        FramePacer& operator=(const FramePacer&) = delete;
+        FramePacer& operator=(FramePacer&&) = delete;
+        ~FramePacer();
+
+        void Configure(FramePacing pacing, uint32_t max_fps);
+        inline FramePacing GetPacing() const { return m_Pacing; }
+        inline uint32_t GetMaxFps() const { return m_MaxFps; }
+
+        void Wait();
+        // The loop slept waiting for events, the next Wait starts a frame straight away and the gap is not a frame time
+        inline void Idle() { m_Started = false; }
+        FramePacerStats GetStats() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        FramePacing m_Pacing = FramePacing::Capped;
+        uint32_t m_MaxFps = 60;
+        Clock::duration m_Period{};
+        Clock::time_point m_Deadline{};
+        Clock::time_point m_LastFrame{};
+        bool m_Started = false;
+
+        double m_OversleepUs = 250.0; // decaying maximum of how late sleep_until returned
+
+        struct Sample
+        {
+            float frame_ms = 0.f;
+            float sleep_ms = 0.f;
+            float spin_ms = 0.f;
+            bool missed = false;
+        };
+        std::array<Sample, s_StatsWindow> m_Samples{};
+        uint64_t m_Frames = 0;
+    };
+
+}
@@ -0,0 +1,180 @@
+#include "safpch.h"
+#include "jobsystem.h"
+
+namespace saf {
+
+    // Which system / queue the current thread works for, non worker threads use the shared queue 0
+    static thread_local const JobSystem* s_Owner = nullptr;
+    static thread_local uint32_t s_QueueIndex = 0;
+
+    JobSystem::JobSystem(uint32_t workers)
+    {
+        if (workers == 0) workers = std::max(1U, std::thread::hardware_concurrency()) - 1;
+        workers = std::max(1U, workers);
+
+        m_Queues.reserve(workers + 1);
+        for (uint32_t n = 0; n <= workers; ++n) m_Queues.emplace_back(std::make_unique<WorkQueue>());
+
+        m_Workers.reserve(workers);
+        for (uint32_t n = 0; n < workers; ++n) m_Workers.emplace_back(&JobSystem::WorkerLoop, this, n + 1);
+
+        IFX_INFO("JobSystem started {0} workers", workers);
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_SleepMutex);
+            m_Running = false;
+        }
+        m_Wake.notify_all();
+
+        for (auto& worker : m_Workers) worker.join();
+    }
+
+    void JobSystem::Run(std::function<void()> function, JobCounter* counter, JobCounter* dependency)
+    {
+        if (counter) counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+
+        Job job{ std::move(function), counter };
+
+        if (dependency)
+        {
+            std::lock_guard<std::mutex> lock(dependency->m_Mutex);
+            if (!dependency->IsDone())
+            {
+                dependency->m_Continuations.emplace_back(std::move(job));
+                return;
+            }
+        }
+
+        Push(std::move(job));
+    }
+
+    void JobSystem::Wait(JobCounter& counter)
+    {
+        const uint32_t queue_index = GetQueueIndex();
+        while (!counter.IsDone())
+        {
+            Job job;
+            if (TryPop(queue_index, job))
+            {
+                Execute(job);
+                continue;
+            }
+
+            // Nothing to help with, sleep until a job is queued or Finish() completes a counter
+            std::unique_lock<std::mutex> lock(m_SleepMutex);
+            m_Wake.wait(lock, [this, &counter]() { return counter.IsDone() || m_Queued > 0; });
+        }
+
+        // Finish() drops the counter's lock after the last decrement, after this nothing touches the counter and it may go out of scope
+        std::lock_guard<std::mutex> lock(counter.m_Mutex);
+    }
+
+    void JobSystem::WorkerLoop(uint32_t queue_index)
+    {
+        s_Owner = this;
+        s_QueueIndex = queue_index;
+
+        while (true)
+        {
+            Job job;
+            if (TryPop(queue_index, job))
+            {
+                Execute(job);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_SleepMutex);
+            if (!m_Running && m_Queued == 0) break;
+            m_Wake.wait(lock, [this]() { return !m_Running || m_Queued > 0; });
+        }
+    }
+
+    void JobSystem::Push(Job&& job)
+    {
+        // Count the job before it becomes visible, a thief popping it right away must never take m_Queued below zero.
+        // Taking the sleep lock orders the increment against a sleeper checking its predicate, no lost wakeups
+        {
+            std::lock_guard<std::mutex> lock(m_SleepMutex);
+            ++m_Queued;
+        }
+
+        WorkQueue& queue = *m_Queues[GetQueueIndex()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.emplace_back(std::move(job));
+        }
+        m_Wake.notify_one();
+    }
+
+    bool JobSystem::TryPop(uint32_t queue_index, Job& job)
+    {
+        if (m_Queued == 0) return false;
+
+        // Own queue newest first
+        {
+            WorkQueue& queue = *m_Queues[queue_index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty())
+            {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+                --m_Queued;
+                return true;
+            }
+        }
+
+        // Steal oldest first, starting at the next queue so thieves spread out
+        const uint32_t count = static_cast<uint32_t>(m_Queues.size());
+        for (uint32_t n = 1; n < count; ++n)
+        {
+            WorkQueue& queue = *m_Queues[(queue_index + n) % count];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty())
+            {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+                --m_Queued;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void JobSystem::Execute(Job& job)
+    {
+        job.function();
+        Finish(job.counter);
+    }
+
+    void JobSystem::Finish(JobCounter* counter)
+    {
+        if (!counter) return;
+
+        bool done = false;
+        std::vector<Job> ready;
+        {
+            std::lock_guard<std::mutex> lock(counter->m_Mutex);
+            done = counter->m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1;
+            if (done) ready.swap(counter->m_Continuations);
+        }
+
+        for (Job& job : ready) Push(std::move(job));
+        if (!done) return;
+
+        // Threads in Wait() sleep on m_Wake too, the empty lock keeps the wakeup from landing between their check and their wait
+        {
+            std::lock_guard<std::mutex> lock(m_SleepMutex);
+        }
+        m_Wake.notify_all();
+    }
+
+    uint32_t JobSystem::GetQueueIndex() const
+    {
+        return s_Owner == this ? s_QueueIndex : 0;
+    }
+
+}
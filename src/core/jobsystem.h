@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+namespace saf {
+
+    class JobCounter;
+
+    struct Job
+    {
+        std::function<void()> function;
+        JobCounter* counter = nullptr;
+    };
+
+    /*
+    Number of unfinished jobs scheduled against it. Any thread can JobSystem::Wait() on a counter,
+    and jobs can be scheduled to start only once a counter reaches zero (dependencies).
+    Counters must outlive the jobs they track, in practice the function that Waits on them.
+    */
+    class JobCounter
+    {
+    public:
+        JobCounter() = default;
+        JobCounter(const JobCounter&) = delete;
+        JobCounter(JobCounter&&) = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+        JobCounter& operator=(JobCounter&&) = delete;
+
+        inline bool IsDone() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<uint32_t> m_Pending{ 0 };
+        std::mutex m_Mutex;
+        std::vector<Job> m_Continuations;
+    };
+
+    /*
+    Work stealing job system:
+
+    - one deque per worker, owners push / pop at the back (LIFO, cache warm), idle workers steal from the front
+    - threads that are not workers (main thread, pipeline stages) submit to a shared queue
+    - Wait() runs jobs while the counter is pending, so waiting inside a job never deadlocks
+    - idle workers and waiters with nothing to run sleep on a condition variable instead of spinning
+
+    Started in entrypoint.cpp and shared through global::g_JobSystem.
+    */
+    class JobSystem
+    {
+    public:
+        explicit JobSystem(uint32_t workers = 0); // 0 = one per core, minus the main thread
+        JobSystem(const JobSystem&) = delete;
+        JobSystem(JobSystem&&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+        JobSystem& operator=(JobSystem&&) = delete;
+        ~JobSystem();
+
+        // Schedules function, counter (optional) is pending until it returns. With a dependency it starts once that counter is done.
+        void Run(std::function<void()> function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+        // Helps executing jobs until counter is done.
+        void Wait(JobCounter& counter);
+
+        // Calls fn(index) for every index < count on at most threads threads (0 = all), the calling thread takes part.
+        template<typename Fn>
+        void ParallelFor(uint32_t count, uint32_t threads, Fn&& fn)
+        {
+            if (threads == 0 || threads > GetThreadCount()) threads = GetThreadCount();
+            threads = std::min(threads, count);
+
+            if (threads <= 1)
+            {
+                for (uint32_t index = 0; index < count; ++index) fn(index);
+                return;
+            }
+
+            std::atomic<uint32_t> next{ 0 };
+            auto body = [&next, &fn, count]()
+                {
+                    for (uint32_t index = next++; index < count; index = next++) fn(index);
+                };
+
+            JobCounter counter;
+            for (uint32_t n = 1; n < threads; ++n) Run(body, &counter);
+            body();
+            Wait(counter);
+        }
+
+        // Workers plus the calling thread
+        inline uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()) + 1; }
+        inline uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+    private:
+        struct WorkQueue
+        {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+
+        void WorkerLoop(uint32_t queue_index);
+        void Push(Job&& job);
+        bool TryPop(uint32_t queue_index, Job& job);
+        void Execute(Job& job);
+        void Finish(JobCounter* counter);
+        uint32_t GetQueueIndex() const;
+
+        // m_Queues[0] is shared by non worker threads, worker n owns m_Queues[n + 1]
+        std::vector<std::unique_ptr<WorkQueue>> m_Queues;
+        std::vector<std::thread> m_Workers;
+
+        std::atomic<uint32_t> m_Queued{ 0 };
+        std::atomic<bool> m_Running{ true };
+        std::mutex m_SleepMutex;
+        std::condition_variable m_Wake;
+    };
+
+}
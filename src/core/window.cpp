@@ -192,6 +192,12 @@ namespace saf {
                 mywindow->m_EventCallback(e);
             });
 
+        glfwSetWindowRefreshCallback(m_glfwWindow, [](GLFWwindow* window)
+            {
+                Window* mywindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
+                mywindow->m_Damaged = true;
+            });
+
         if (glfwRawMouseMotionSupported()) glfwSetInputMode(m_glfwWindow, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
         else IFX_TRACE("Raw input not supported");
 
@@ -243,7 +249,8 @@ namespace saf {
                 "VK_KHR_swapchain",
                 "VK_KHR_dynamic_rendering",
                 "VK_KHR_dedicated_allocation"
-            });
+            },
+            true);
 
 
             std::vector<vk::SurfaceFormatKHR> supported_formats = global::g_PhysicalDevice.getSurfaceFormatsKHR(global::g_Surface);
@@ -262,48 +269,21 @@ namespace saf {
             vk::SurfaceFormatKHR image_format = (format_it == supported_formats.end()) ? *format_it : supported_formats[0];
             global::g_SurfaceFormat = image_format;
 
-            vma::VulkanFunctions vulkanFunctions = {};
-            vulkanFunctions.vkGetInstanceProcAddr = VULKAN_HPP_DEFAULT_DISPATCHER.vkGetInstanceProcAddr;
-            vulkanFunctions.vkGetDeviceProcAddr = VULKAN_HPP_DEFAULT_DISPATCHER.vkGetDeviceProcAddr;
-
-            vma::AllocatorCreateInfo vma_alloc_create_info = {};
-            vma_alloc_create_info.device = global::g_Device;
-            vma_alloc_create_info.flags = {};
-            vma_alloc_create_info.instance = global::g_Instance;
-            vma_alloc_create_info.physicalDevice = global::g_PhysicalDevice;
-            vma_alloc_create_info.vulkanApiVersion = VK_API_VERSION_1_3;
-            vma_alloc_create_info.pVulkanFunctions = &vulkanFunctions;
-
-            if (vma::createAllocator(&vma_alloc_create_info, &global::g_Allocator) != vk::Result::eSuccess)
-                IFX_ERROR("Failed to create allocator");
+            global::g_Allocator = vkhelper::CreateAllocator(global::g_Instance, global::g_PhysicalDevice, global::g_Device);
 
             vk::PipelineRenderingCreateInfo pipeline_rendering_create_info({}, { global::g_SurfaceFormat.format }, vk::Format::eUndefined, vk::Format::eUndefined);
 
-            std::array<vk::DescriptorPoolSize, 11> pool_sizes =
-            {
-                vk::DescriptorPoolSize(vk::DescriptorType::eSampler, 100),
-                vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 100),
-                vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, 100),
-                vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, 100),
-                vk::DescriptorPoolSize(vk::DescriptorType::eUniformTexelBuffer, 100),
-                vk::DescriptorPoolSize(vk::DescriptorType::eStorageTexelBuffer, 100),
-                vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, 100),
-                vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 100),
-                vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, 100),
-                vk::DescriptorPoolSize(vk::DescriptorType::eStorageBufferDynamic, 100),
-                vk::DescriptorPoolSize(vk::DescriptorType::eInputAttachment, 100)
-            };
+            global::g_DescriptorPool = vkhelper::CreateDescriptorPool(global::g_Device);
 
-            vk::DescriptorPoolCreateInfo pool_create_info{};
-            pool_create_info.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
-            pool_create_info.maxSets = 1000;
-            pool_create_info.poolSizeCount = std::size(pool_sizes);
-            pool_create_info.pPoolSizes = pool_sizes.data();
-
-            global::g_DescriptorPool = global::g_Device.createDescriptorPool(pool_create_info);
+            global::g_PipelineCache = std::make_shared<PipelineCache>();
+            global::g_PipelineCache->Init(global::g_PipelineCachePath);
 
             global::g_GraphicsQueue = global::g_Device.getQueue(global::g_GraphicsQueueIndex, 0);
 
+            // Effects submit to the graphics queue, it is the only queue we create
+            global::g_ComputeQueueIndex = global::g_GraphicsQueueIndex;
+            global::g_ComputeQueue = global::g_GraphicsQueue;
+
             ImGui_ImplVulkan_InitInfo imgui_vulkan_impl_info{};
             imgui_vulkan_impl_info.ApiVersion = VK_API_VERSION_1_3;
             imgui_vulkan_impl_info.Instance = global::g_Instance;
@@ -315,6 +295,7 @@ namespace saf {
             imgui_vulkan_impl_info.ImageCount = 3;
             imgui_vulkan_impl_info.UseDynamicRendering = true;
             imgui_vulkan_impl_info.DescriptorPool = global::g_DescriptorPool;
+            imgui_vulkan_impl_info.PipelineCache = global::g_PipelineCache->Get();
             imgui_vulkan_impl_info.PipelineRenderingCreateInfo = static_cast<VkPipelineRenderingCreateInfoKHR>(pipeline_rendering_create_info);
             imgui_vulkan_impl_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
             ImGui_ImplVulkan_Init(&imgui_vulkan_impl_info);
@@ -330,6 +311,7 @@ namespace saf {
 
         ImGui_ImplVulkan_Shutdown();
 
+        global::g_PipelineCache.reset();
         if (global::g_DescriptorPool) global::g_Device.destroyDescriptorPool(global::g_DescriptorPool);
 
         if (global::g_Allocator) global::g_Allocator.destroy();
@@ -339,14 +321,20 @@ namespace saf {
         if (global::g_Instance) global::g_Instance.destroy();
     }
 
-    void Window::Update()
+    void Window::Update(double wait_seconds)
     {
         if (!m_EventCallback) m_EventCallback = [](Event& e)
             {
                 IFX_TRACE("{0}", e.ToString());
             };
 
-        glfwPollEvents();
+        if (wait_seconds > 0.0) glfwWaitEventsTimeout(wait_seconds);
+        else glfwPollEvents();
+    }
+
+    void Window::Wake()
+    {
+        glfwPostEmptyEvent();
     }
 
     bool Window::ShouldClose() const
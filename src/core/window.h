@@ -33,7 +33,12 @@ namespace saf {
 
         void Init();
         void Shutdown();
-        void Update();
+        // Polls events, with wait_seconds > 0 blocks until one arrives or wait_seconds pass
+        void Update(double wait_seconds = 0.0);
+        // Wakes a blocked Update, callable from any thread
+        void Wake();
+        // True once after the window contents were lost (exposed, restored) and have to be drawn again
+        inline bool ConsumeDamage() { bool damaged = m_Damaged; m_Damaged = false; return damaged; }
 
         bool ShouldClose() const;
         inline uint32_t GetWidth() const { return m_Width; }
@@ -57,6 +62,7 @@ namespace saf {
         EventCallbackFn m_EventCallback;
         bool m_CursorState;
         bool m_CursorStateChange;
+        bool m_Damaged = true;
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,254 @@
+#include "safpch.h"
+#include "batch.h"
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <unordered_set>
+
+#include "effects/boundedqueue.h"
+
+namespace saf {
+
+    namespace effects {
+
+        namespace fs = std::filesystem;
+        using Clock = std::chrono::high_resolution_clock;
+
+        struct BatchItem
+        {
+            const BatchJob* job = nullptr;
+            ImageBuffer image;
+        };
+
+        static std::string LowerExtension(const fs::path& path)
+        {
+            std::string ext = path.extension().string();
+            std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return ext;
+        }
+
+        static bool IsManifest(const fs::path& path)
+        {
+            const std::string ext = LowerExtension(path);
+            return ext == ".txt" || ext == ".manifest";
+        }
+
+        // Extensions stb_image decodes
+        static bool IsImage(const fs::path& path)
+        {
+            static const std::array<const char*, 11> extensions = { ".png", ".jpg", ".jpeg", ".bmp", ".tga", ".psd", ".gif", ".hdr", ".pic", ".pgm", ".ppm" };
+            const std::string ext = LowerExtension(path);
+            return std::find_if(extensions.begin(), extensions.end(), [&ext](const char* e) { return ext == e; }) != extensions.end();
+        }
+
+        // Output path in dst_dir, formats ImageBuffer::Save cannot write become png
+        static std::string DefaultDestination(const fs::path& src, const fs::path& dst_dir)
+        {
+            fs::path dst = dst_dir / src.filename();
+            const std::string ext = LowerExtension(dst);
+            if (ext != ".png" && ext != ".jpg" && ext != ".jpeg" && ext != ".bmp" && ext != ".tga") dst.replace_extension(".png");
+            return dst.string();
+        }
+
+        static std::string NormalizePath(const std::string& path)
+        {
+            std::error_code error;
+            const fs::path canonical = fs::weakly_canonical(path, error);
+            return error ? fs::path(path).lexically_normal().string() : canonical.string();
+        }
+
+        // Appends _1, _2, ... to the stem until the destination is neither a source nor an earlier output
+        static std::string UniqueDestination(const std::string& dst, std::unordered_set<std::string>& taken)
+        {
+            if (taken.insert(NormalizePath(dst)).second) return dst;
+
+            const fs::path path(dst);
+            for (uint32_t n = 1;; ++n)
+            {
+                fs::path candidate = path.parent_path() / (path.stem().string() + "_" + std::to_string(n) + path.extension().string());
+                if (taken.insert(NormalizePath(candidate.string())).second) return candidate.string();
+            }
+        }
+
+        bool IsBatchSource(const std::string& src)
+        {
+            std::error_code error;
+            return fs::is_directory(src, error) || IsManifest(src);
+        }
+
+        std::vector<BatchJob> CollectBatchJobs(const std::string& src, const std::string& dst_dir)
+        {
+            std::vector<BatchJob> jobs;
+            std::vector<bool> explicit_dst;
+            std::error_code error;
+
+            if (fs::is_directory(src, error))
+            {
+                for (const auto& entry : fs::directory_iterator(src, error))
+                {
+                    if (entry.is_regular_file() && IsImage(entry.path())) jobs.push_back({ entry.path().string(), DefaultDestination(entry.path(), dst_dir) });
+                }
+                explicit_dst.assign(jobs.size(), false);
+
+                // Directory order is unspecified, sort so runs are reproducible
+                std::sort(jobs.begin(), jobs.end(), [](const BatchJob& a, const BatchJob& b) { return a.src < b.src; });
+            }
+            else
+            {
+                std::ifstream manifest(src);
+                if (!manifest) IFX_ERROR("Failed to open manifest {0}", src);
+
+                std::string line;
+                while (std::getline(manifest, line))
+                {
+                    if (!line.empty() && line.back() == '\r') line.pop_back();
+                    if (line.empty() || line.front() == '#') continue;
+
+                    const size_t tab = line.find('\t');
+                    if (tab == std::string::npos) jobs.push_back({ line, DefaultDestination(line, dst_dir) });
+                    else jobs.push_back({ line.substr(0, tab), line.substr(tab + 1) });
+                    explicit_dst.push_back(tab != std::string::npos);
+                }
+            }
+
+            // Never write over an input or over another job's output: explicit manifest paths must be unique,
+            // derived ones get a numbered suffix when two sources share a file name or dst_dir is the source directory
+            std::unordered_set<std::string> taken;
+            for (const BatchJob& job : jobs) taken.insert(NormalizePath(job.src));
+            for (size_t i = 0; i < jobs.size(); ++i)
+            {
+                if (!explicit_dst[i]) continue;
+                if (!taken.insert(NormalizePath(jobs[i].dst)).second) IFX_ERROR("Manifest {0} writes {1} over an input or another output", src, jobs[i].dst);
+            }
+            for (size_t i = 0; i < jobs.size(); ++i)
+            {
+                if (!explicit_dst[i]) jobs[i].dst = UniqueDestination(jobs[i].dst, taken);
+            }
+
+            fs::create_directories(dst_dir, error);
+            if (error) IFX_ERROR("Failed to create output directory {0}: {1}", dst_dir, error.message());
+
+            return jobs;
+        }
+
+        // Starts workers threads running body(), the last one to finish calls done() to close the stage's output queue.
+        template<typename Body, typename Done>
+        static void StartStage(std::vector<std::thread>& threads, uint32_t workers, std::atomic<uint32_t>& remaining, Body body, Done done)
+        {
+            remaining = workers;
+            for (uint32_t n = 0; n < workers; ++n)
+            {
+                threads.emplace_back([&remaining, body, done]()
+                    {
+                        body();
+                        if (--remaining == 0) done();
+                    });
+            }
+        }
+
+        static double SecondsSince(Clock::time_point start)
+        {
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        BatchStats RunBatch(const std::vector<BatchJob>& jobs, const BatchEffectFn& effect, const BatchOptions& options)
+        {
+            BatchStats stats{};
+            if (jobs.empty()) return stats;
+
+            const uint32_t job_count = static_cast<uint32_t>(jobs.size());
+            const uint32_t cores = std::max(1U, std::thread::hardware_concurrency());
+
+            // Decode and encode are the expensive stages, they split the cores. A single effect worker fans out over all cores per image,
+            // which keeps peak memory at a handful of images instead of one per core.
+            stats.decode_threads = std::min(job_count, options.decode_threads ? options.decode_threads : std::max(1U, cores / 2));
+            stats.encode_threads = std::min(job_count, options.encode_threads ? options.encode_threads : std::max(1U, cores - cores / 2));
+            stats.effect_threads = std::min(job_count, options.effect_threads ? options.effect_threads : 1U);
+            const uint32_t threads_per_effect = std::max(1U, cores / stats.effect_threads);
+            const uint32_t queue_depth = options.queue_depth ? options.queue_depth : 2;
+
+            BoundedQueue<BatchItem> decoded(queue_depth);
+            BoundedQueue<BatchItem> processed(queue_depth);
+
+            std::atomic<uint32_t> next_job{ 0 };
+            std::atomic<uint32_t> images{ 0 }, failed{ 0 };
+            std::atomic<uint64_t> pixels{ 0 };
+            std::atomic<uint64_t> decode_ns{ 0 }, effect_ns{ 0 }, encode_ns{ 0 };
+            std::atomic<uint32_t> decoders{ 0 }, effectors{ 0 }, encoders{ 0 };
+
+            auto add_time = [](std::atomic<uint64_t>& total, Clock::time_point start)
+                {
+                    total += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+                };
+
+            const auto start = Clock::now();
+            std::vector<std::thread> threads;
+            threads.reserve(stats.decode_threads + stats.effect_threads + stats.encode_threads);
+
+            StartStage(threads, stats.decode_threads, decoders, [&]()
+                {
+                    for (uint32_t index = next_job++; index < job_count; index = next_job++)
+                    {
+                        auto begin = Clock::now();
+                        BatchItem item;
+                        item.job = &jobs[index];
+                        const bool loaded = item.image.Load(item.job->src);
+                        add_time(decode_ns, begin);
+
+                        if (!loaded) { ++failed; continue; }
+                        if (!decoded.Push(std::move(item))) return;
+                    }
+                }, [&]() { decoded.Close(); });
+
+            StartStage(threads, stats.effect_threads, effectors, [&]()
+                {
+                    BatchItem item;
+                    while (decoded.Pop(item))
+                    {
+                        auto begin = Clock::now();
+                        effect(item.image, threads_per_effect);
+                        add_time(effect_ns, begin);
+
+                        if (!processed.Push(std::move(item))) return;
+                    }
+                }, [&]() { processed.Close(); });
+
+            StartStage(threads, stats.encode_threads, encoders, [&]()
+                {
+                    BatchItem item;
+                    while (processed.Pop(item))
+                    {
+                        auto begin = Clock::now();
+                        const bool saved = item.image.Save(item.job->dst);
+                        const uint64_t count = item.image.GetPixelCount();
+                        item.image.Release();
+                        add_time(encode_ns, begin);
+
+                        if (saved)
+                        {
+                            ++images;
+                            pixels += count;
+                        }
+                        else ++failed;
+                    }
+                }, []() {});
+
+            for (auto& thread : threads) thread.join();
+
+            stats.seconds = SecondsSince(start);
+            stats.images = images;
+            stats.failed = failed;
+            stats.pixels = pixels;
+            stats.decode_seconds = static_cast<double>(decode_ns) / 1e9;
+            stats.effect_seconds = static_cast<double>(effect_ns) / 1e9;
+            stats.encode_seconds = static_cast<double>(encode_ns) / 1e9;
+            return stats;
+        }
+
+    }
+
+}
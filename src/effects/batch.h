@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "effects/imagebuffer.h"
+#include "effects/effectstats.h"
+
+namespace saf {
+
+    namespace effects {
+
+        struct BatchJob
+        {
+            std::string src;
+            std::string dst;
+        };
+
+        // 0 picks a default from the core count, queue_depth is the capacity of each queue between two stages.
+        struct BatchOptions
+        {
+            uint32_t decode_threads = 0;
+            uint32_t effect_threads = 0;
+            uint32_t encode_threads = 0;
+            uint32_t queue_depth = 0;
+        };
+
+        // Stage seconds are busy time summed over that stage's workers, wall time is in seconds.
+        struct BatchStats
+        {
+            uint32_t images = 0;
+            uint32_t failed = 0;
+            uint64_t pixels = 0;
+            double seconds = 0.0;
+
+            uint32_t decode_threads = 0;
+            uint32_t effect_threads = 0;
+            uint32_t encode_threads = 0;
+            double decode_seconds = 0.0;
+            double effect_seconds = 0.0;
+            double encode_seconds = 0.0;
+        };
+
+        // Runs the effect on one image with the given number of threads.
+        using BatchEffectFn = std::function<EffectStats(ImageBuffer&, uint32_t threads)>;
+
+        // A directory, or a manifest (.txt / .manifest) listing one "src" or "src<TAB>dst" per line.
+        bool IsBatchSource(const std::string& src);
+
+        // Expands a batch source into jobs, outputs without an explicit path go to dst_dir under the source file name
+        // (numbered when that would overwrite an input or another output). Explicit manifest outputs must be unique.
+        std::vector<BatchJob> CollectBatchJobs(const std::string& src, const std::string& dst_dir);
+
+        /*
+        * Three stage pipeline: decode -> effect -> encode, each stage on its own threads, joined by BoundedQueues.
+        * Full queues block the stage in front of them, so at most the queued images plus one per worker are in memory
+        * and throughput settles at the rate of the slowest stage.
+        */
+        BatchStats RunBatch(const std::vector<BatchJob>& jobs, const BatchEffectFn& effect, const BatchOptions& options = {});
+
+    }
+
+}
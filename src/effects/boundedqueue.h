@@ -0,0 +1,69 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+namespace saf {
+
+    namespace effects {
+
+        /*
+        * Blocking multi producer / multi consumer queue with a fixed capacity.
+        * Push() waits while the queue is full, which is what applies backpressure to the stage in front of it.
+        * Once closed, Push() fails and Pop() drains what is left and then returns false.
+        */
+        template<typename T>
+        class BoundedQueue
+        {
+        public:
+            explicit BoundedQueue(uint32_t capacity) : m_Capacity(capacity ? capacity : 1) {}
+
+            bool Push(T&& item)
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_NotFull.wait(lock, [this]() { return m_Closed || m_Items.size() < m_Capacity; });
+                if (m_Closed) return false;
+
+                m_Items.emplace_back(std::move(item));
+                lock.unlock();
+                m_NotEmpty.notify_one();
+                return true;
+            }
+
+            bool Pop(T& item)
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_NotEmpty.wait(lock, [this]() { return m_Closed || !m_Items.empty(); });
+                if (m_Items.empty()) return false;
+
+                item = std::move(m_Items.front());
+                m_Items.pop_front();
+                lock.unlock();
+                m_NotFull.notify_one();
+                return true;
+            }
+
+            void Close()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    m_Closed = true;
+                }
+                m_NotFull.notify_all();
+                m_NotEmpty.notify_all();
+            }
+
+        private:
+            std::mutex m_Mutex;
+            std::condition_variable m_NotFull;
+            std::condition_variable m_NotEmpty;
+            std::deque<T> m_Items;
+            uint32_t m_Capacity;
+            bool m_Closed = false;
+        };
+
+    }
+
+}
@@ -0,0 +1,71 @@
+#include "safpch.h"
+#include "boxblur.h"
+
+#include "effects/integralimage.h"
+#include "effects/parallel.h"
+
+namespace saf {
+
+    namespace effects {
+
+        static constexpr uint32_t s_RowsPerTask = 16;
+
+        EffectStats BoxBlur(ImageBuffer& image, uint32_t radius, uint32_t threads)
+        {
+            EffectStats stats{};
+            if (image.Empty() || radius == 0) return stats;
+
+            const uint32_t width = image.GetWidth();
+            const uint32_t height = image.GetHeight();
+            const uint32_t channels = image.GetChannels();
+            const uint32_t tasks = (height + s_RowsPerTask - 1) / s_RowsPerTask;
+
+            stats.tiles = tasks;
+            stats.threads = ResolveThreadCount(threads, tasks);
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            SummedAreaTable table;
+            table.Build(image, threads);
+            stats.kernels = table.IsWide() ? "sat64" : "sat32";
+
+            ImageBuffer output(width, height, channels);
+
+            table.Visit([&](const auto& sat)
+                {
+                    using T = std::decay_t<decltype(sat.At(0, 0, 0))>;
+
+                    ParallelFor(tasks, threads, [&](uint32_t task)
+                        {
+                            const uint32_t y_begin = task * s_RowsPerTask;
+                            const uint32_t y_end = std::min(height, y_begin + s_RowsPerTask);
+
+                            for (uint32_t y = y_begin; y < y_end; ++y)
+                            {
+                                const uint32_t y0 = y > radius ? y - radius : 0;
+                                const uint32_t y1 = std::min(height, y + radius + 1);
+                                uint8_t* dst = output.GetRow(y);
+
+                                for (uint32_t x = 0; x < width; ++x)
+                                {
+                                    const uint32_t x0 = x > radius ? x - radius : 0;
+                                    const uint32_t x1 = std::min(width, x + radius + 1);
+                                    const T count = static_cast<T>(x1 - x0) * (y1 - y0);
+
+                                    T sum[4];
+                                    sat.Sum(x0, y0, x1, y1, sum);
+                                    for (uint32_t k = 0; k < channels; ++k) dst[x * channels + k] = static_cast<uint8_t>((sum[k] + count / 2) / count);
+                                }
+                            }
+                        });
+                });
+
+            image = std::move(output);
+
+            stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            return stats;
+        }
+
+    }
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "effects/imagebuffer.h"
+#include "effects/effectstats.h"
+
+namespace saf {
+
+    namespace effects {
+
+        /*
+        * Averages every pixel over the (2 * radius + 1)^2 window around it, clipped to the image.
+        * Window sums come from a SummedAreaTable so the cost per pixel does not depend on the radius.
+        */
+        EffectStats BoxBlur(ImageBuffer& image, uint32_t radius, uint32_t threads = 0);
+
+    }
+
+}
@@ -0,0 +1,147 @@
+#include "safpch.h"
+#include "commands.h"
+
+#include <functional>
+
+#include "globals.h"
+#include "effects/batch.h"
+#include "effects/boxblur.h"
+#include "effects/imagebuffer.h"
+#include "effects/pixelate.h"
+#include "effects/pixelategpu.h"
+#include "effects/pixelatekernels.h"
+#include "render/computedevice.h"
+#include "render/glyphkernels.h"
+#include "render/renderer2d.h"
+#include "utils/argumentmanager.h"
+
+namespace saf {
+
+    namespace effects {
+
+        using Clock = std::chrono::high_resolution_clock;
+
+        static double MillisecondsSince(Clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        // effect(image, parameter, threads)
+        using EffectFn = std::function<EffectStats(ImageBuffer&, uint32_t, uint32_t)>;
+
+        static void RunBatchEffect(const std::string& src, const std::string& dst, const char* name, uint32_t parameter, const EffectFn& effect, const BatchOptions& options)
+        {
+            std::vector<BatchJob> jobs = CollectBatchJobs(src, dst);
+            if (jobs.empty()) IFX_ERROR("-{0} found no images in {1}", name, src);
+
+            BatchStats stats = RunBatch(jobs, [&effect, parameter](ImageBuffer& image, uint32_t threads) { return effect(image, parameter, threads); }, options);
+
+            const double megapixels = static_cast<double>(stats.pixels) / 1e6;
+            IFX_INFO("-{0} {1} -> {2} ({3} images, {4} failed, {0} {5})", name, src, dst, stats.images, stats.failed, parameter);
+            IFX_INFO("\tdecode: {0:.2f} s busy on {1} threads", stats.decode_seconds, stats.decode_threads);
+            IFX_INFO("\teffect: {0:.2f} s busy on {1} threads", stats.effect_seconds, stats.effect_threads);
+            IFX_INFO("\tencode: {0:.2f} s busy on {1} threads", stats.encode_seconds, stats.encode_threads);
+            IFX_INFO("\ttotal: {0:.2f} s, {1:.1f} images/s, {2:.1f} MP/s end to end", stats.seconds, stats.images / stats.seconds, megapixels / stats.seconds);
+        }
+
+        // Shared load -> effect -> save path for the effect commands, name is the params.json argument.
+        // A directory or manifest src runs the batch pipeline instead, see effects/batch.h.
+        static void RunEffect(const nlohmann::json& args, const char* name, const char* usage, const EffectFn& effect, const BatchOptions& batch_options = {})
+        {
+            if (!args.contains("src") || !args.contains("dst")) IFX_ERROR(usage);
+
+            const std::string src = args["src"];
+            const std::string dst = args["dst"];
+            const uint32_t parameter = GetUIntArgument(args, name);
+
+            if (IsBatchSource(src))
+            {
+                RunBatchEffect(src, dst, name, parameter, effect, batch_options);
+                return;
+            }
+
+            auto start = Clock::now();
+            ImageBuffer image;
+            if (!image.Load(src)) IFX_ERROR("-{0} failed to load {1}", name, src);
+            double decode_ms = MillisecondsSince(start);
+
+            EffectStats stats = effect(image, parameter, 0);
+
+            start = Clock::now();
+            if (!image.Save(dst)) IFX_ERROR("-{0} failed to write {1}", name, dst);
+            double encode_ms = MillisecondsSince(start);
+
+            const double megapixels = static_cast<double>(image.GetPixelCount()) / 1e6;
+            IFX_INFO("-{0} {1} -> {2} ({3}x{4}x{5}, {0} {6})", name, src, dst, image.GetWidth(), image.GetHeight(), image.GetChannels(), parameter);
+            IFX_INFO("\tdecode: {0:.2f} ms", decode_ms);
+            IFX_INFO("\teffect: {0:.2f} ms, {1:.1f} MP/s ({2} tiles on {3} threads, {4} kernels)", stats.seconds * 1000.0, stats.MegapixelsPerSecond(image.GetPixelCount()), stats.tiles, stats.threads, stats.kernels);
+            IFX_INFO("\tencode: {0:.2f} ms", encode_ms);
+            IFX_INFO("\ttotal: {0:.1f} MP/s end to end", megapixels / ((decode_ms + stats.seconds * 1000.0 + encode_ms) / 1000.0));
+        }
+
+        bool RunCommand(const nlohmann::json& args)
+        {
+            if (!args.is_object()) return false;
+
+            if (args.contains("pixelate"))
+            {
+                if (args.contains("gpu"))
+                {
+                    // One queue, so GPU batches keep a single effect worker
+                    BatchOptions options;
+                    options.effect_threads = 1;
+
+                    ComputeDevice device;
+                    device.Init();
+                    PixelatePipeline pipeline;
+                    pipeline.Init();
+                    global::g_PipelineCache->LogStats("at startup");
+                    RunEffect(args, "pixelate", "Usage ImageFX [src] [dst] -pixelate <reduction> [-gpu]", [&pipeline](ImageBuffer& image, uint32_t reduction, uint32_t) { return PixelateGPU(pipeline, image, reduction); }, options);
+                    pipeline.Shutdown();
+                    device.Shutdown();
+                }
+                else RunEffect(args, "pixelate", "Usage ImageFX [src] [dst] -pixelate <reduction> [-gpu]", [](ImageBuffer& image, uint32_t reduction, uint32_t threads) { return Pixelate(image, reduction, threads); });
+                return true;
+            }
+
+            if (args.contains("blur"))
+            {
+                RunEffect(args, "blur", "Usage ImageFX [src] [dst] -blur <radius>", [](ImageBuffer& image, uint32_t radius, uint32_t threads) { return BoxBlur(image, radius, threads); });
+                return true;
+            }
+
+            if (args.contains("validatekernels"))
+            {
+                // The debug builds check this on first use, release builds ship the SIMD paths unchecked
+                const bool pixelate = ValidatePixelateKernels();
+                const bool glyphs = ValidateGlyphKernels();
+                IFX_INFO("Pixelate kernels: {0}", pixelate ? "match scalar" : "DIFFER from scalar");
+                IFX_INFO("Glyph kernels: {0}", glyphs ? "match scalar" : "DIFFER from scalar");
+                if (!pixelate || !glyphs) IFX_ERROR("-validatekernels found kernels that differ from the scalar reference");
+                return true;
+            }
+
+            if (args.contains("glyphbench"))
+            {
+                // Timings of a kernel that is wrong mean nothing, check them first in every build
+                if (!ValidateGlyphKernels()) IFX_ERROR("-glyphbench glyph kernels differ from the scalar reference");
+                BenchmarkGlyphKernels(GetUIntArgument(args, "glyphbench"), 1000);
+                return true;
+            }
+
+            if (args.contains("instancebench"))
+            {
+                ComputeDevice device;
+                device.Init();
+                BenchmarkInstanceStaging(GetUIntArgument(args, "instancebench"), 1000);
+                BenchmarkInstanceLayouts(GetUIntArgument(args, "instancebench"), 1000);
+                device.Shutdown();
+                return true;
+            }
+
+            return false;
+        }
+
+    }
+
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "nlohmann/json.hpp"
+
+namespace saf {
+
+    namespace effects {
+
+        // Runs the effect command found in the run arguments (see assets/params.json).
+        // Returns false if the arguments contain no effect command, so the caller can start the application instead.
+        bool RunCommand(const nlohmann::json& args);
+
+    }
+
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace saf {
+
+    namespace effects {
+
+        struct EffectStats
+        {
+            uint32_t tiles = 0;
+            uint32_t threads = 0;
+            const char* kernels = "";
+            double seconds = 0.0;
+
+            inline double MegapixelsPerSecond(uint64_t pixels) const { return seconds > 0.0 ? static_cast<double>(pixels) / seconds / 1e6 : 0.0; }
+        };
+
+    }
+
+}
@@ -0,0 +1,106 @@
+#include "safpch.h"
+#include "imagebuffer.h"
+
+#include <cctype>
+
+#include <stb/stb_image.h>
+#include <stb/stb_image_write.h>
+
+namespace saf {
+
+    ImageBuffer::ImageBuffer(uint32_t width, uint32_t height, uint32_t channels)
+        : m_Data(new uint8_t[static_cast<size_t>(width) * height * channels]), m_StbOwned(false), m_Width(width), m_Height(height), m_Channels(channels)
+    {
+
+    }
+
+    ImageBuffer::ImageBuffer(ImageBuffer&& other) noexcept
+        : m_Data(other.m_Data), m_StbOwned(other.m_StbOwned), m_Width(other.m_Width), m_Height(other.m_Height), m_Channels(other.m_Channels)
+    {
+        other.m_Data = nullptr;
+        other.Release();
+    }
+
+    ImageBuffer& ImageBuffer::operator=(ImageBuffer&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Release();
+            m_Data = other.m_Data;
+            m_StbOwned = other.m_StbOwned;
+            m_Width = other.m_Width;
+            m_Height = other.m_Height;
+            m_Channels = other.m_Channels;
+            other.m_Data = nullptr;
+            other.Release();
+        }
+        return *this;
+    }
+
+    ImageBuffer::~ImageBuffer()
+    {
+        Release();
+    }
+
+    void ImageBuffer::Release()
+    {
+        if (m_Data)
+        {
+            if (m_StbOwned) stbi_image_free(m_Data);
+            else delete[] m_Data;
+        }
+
+        m_Data = nullptr;
+        m_StbOwned = false;
+        m_Width = m_Height = m_Channels = 0;
+    }
+
+    bool ImageBuffer::Load(const std::string& path, uint32_t desired_channels)
+    {
+        Release();
+
+        int width, height, channels;
+        uint8_t* data = stbi_load(path.c_str(), &width, &height, &channels, static_cast<int>(desired_channels));
+        if (!data)
+        {
+            IFX_WARN("ImageBuffer failed to load {0}: {1}", path, stbi_failure_reason());
+            return false;
+        }
+
+        m_Data = data;
+        m_StbOwned = true;
+        m_Width = static_cast<uint32_t>(width);
+        m_Height = static_cast<uint32_t>(height);
+        m_Channels = desired_channels ? desired_channels : static_cast<uint32_t>(channels);
+
+        return true;
+    }
+
+    bool ImageBuffer::Save(const std::string& path) const
+    {
+        if (Empty())
+        {
+            IFX_WARN("ImageBuffer cannot save empty image to {0}", path);
+            return false;
+        }
+
+        std::string ext = path.substr(path.find_last_of('.') + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+        int w = static_cast<int>(m_Width), h = static_cast<int>(m_Height), c = static_cast<int>(m_Channels);
+
+        int result = 0;
+        if (ext == "jpg" || ext == "jpeg") result = stbi_write_jpg(path.c_str(), w, h, c, m_Data, 95);
+        else if (ext == "bmp") result = stbi_write_bmp(path.c_str(), w, h, c, m_Data);
+        else if (ext == "tga") result = stbi_write_tga(path.c_str(), w, h, c, m_Data);
+        else
+        {
+            if (ext != "png") IFX_WARN("ImageBuffer unknown extension \"{0}\", writing png", ext);
+            result = stbi_write_png(path.c_str(), w, h, c, m_Data, static_cast<int>(GetStride()));
+        }
+
+        if (!result) IFX_WARN("ImageBuffer failed to write {0}", path);
+        return result != 0;
+    }
+
+}
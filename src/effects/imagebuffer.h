@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+namespace saf {
+
+    /*
+    * Tightly packed 8 bit per channel image in host memory, rows are Stride() bytes apart.
+    * Loaded and saved through stb_image / stb_image_write (see utils/stbimpl.cpp).
+    */
+    class ImageBuffer
+    {
+    public:
+        ImageBuffer() = default;
+        ImageBuffer(uint32_t width, uint32_t height, uint32_t channels);
+        ImageBuffer(const ImageBuffer&) = delete;
+        ImageBuffer(ImageBuffer&& other) noexcept;
+        ImageBuffer& operator=(const ImageBuffer&) = delete;
+        ImageBuffer& operator=(ImageBuffer&& other) noexcept;
+        ~ImageBuffer();
+
+        bool Load(const std::string& path, uint32_t desired_channels = 0);
+        bool Save(const std::string& path) const;
+        void Release();
+
+        inline bool Empty() const { return m_Data == nullptr; }
+        inline uint8_t* GetData() { return m_Data; }
+        inline const uint8_t* GetData() const { return m_Data; }
+        inline uint8_t* GetRow(uint32_t y) { return m_Data + static_cast<size_t>(y) * GetStride(); }
+        inline const uint8_t* GetRow(uint32_t y) const { return m_Data + static_cast<size_t>(y) * GetStride(); }
+
+        inline uint32_t GetWidth() const { return m_Width; }
+        inline uint32_t GetHeight() const { return m_Height; }
+        inline uint32_t GetChannels() const { return m_Channels; }
+        inline size_t GetStride() const { return static_cast<size_t>(m_Width) * m_Channels; }
+        inline size_t GetSize() const { return GetStride() * m_Height; }
+        inline uint64_t GetPixelCount() const { return static_cast<uint64_t>(m_Width) * m_Height; }
+
+    private:
+        uint8_t* m_Data = nullptr;
+        bool m_StbOwned = false;
+
+        uint32_t m_Width = 0;
+        uint32_t m_Height = 0;
+        uint32_t m_Channels = 0;
+    };
+
+}
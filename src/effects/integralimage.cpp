@@ -0,0 +1,110 @@
+#include "safpch.h"
+#include "integralimage.h"
+
+#include "effects/parallel.h"
+
+namespace saf {
+
+    namespace effects {
+
+        // Columns (in table entries) each worker owns during the vertical pass, rows are walked top to bottom.
+        static constexpr size_t s_ColumnStripWidth = 1024;
+
+        template<typename T, uint32_t C>
+        static void ScanRow(const uint8_t* src, T* dst, uint32_t width)
+        {
+            T run[C] = {};
+            for (uint32_t k = 0; k < C; ++k) dst[k] = 0;
+            dst += C;
+
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                for (uint32_t k = 0; k < C; ++k)
+                {
+                    run[k] += src[x * C + k];
+                    dst[x * C + k] = run[k];
+                }
+            }
+        }
+
+        template<typename T>
+        void IntegralImage<T>::Build(const ImageBuffer& image, uint32_t threads)
+        {
+            m_Width = image.GetWidth();
+            m_Height = image.GetHeight();
+            m_Channels = image.GetChannels();
+
+            if (m_Channels == 0 || m_Channels > 4)
+            {
+                IFX_WARN("IntegralImage does not support {0} channel images", m_Channels);
+                Clear();
+                return;
+            }
+
+            const size_t row = static_cast<size_t>(m_Width + 1) * m_Channels;
+            m_Data = std::unique_ptr<T[]>(new T[row * (m_Height + 1)]);
+            std::fill(m_Data.get(), m_Data.get() + row, T(0));
+
+            // Horizontal prefix scan, rows are independent
+            ParallelFor(m_Height, threads, [this, &image, row](uint32_t y)
+                {
+                    T* dst = m_Data.get() + (static_cast<size_t>(y) + 1) * row;
+                    switch (m_Channels)
+                    {
+                    case 1: ScanRow<T, 1>(image.GetRow(y), dst, m_Width); break;
+                    case 2: ScanRow<T, 2>(image.GetRow(y), dst, m_Width); break;
+                    case 3: ScanRow<T, 3>(image.GetRow(y), dst, m_Width); break;
+                    case 4: ScanRow<T, 4>(image.GetRow(y), dst, m_Width); break;
+                    }
+                });
+
+            // Vertical prefix scan, strips of columns are independent
+            const uint32_t strips = static_cast<uint32_t>((row + s_ColumnStripWidth - 1) / s_ColumnStripWidth);
+            ParallelFor(strips, threads, [this, row](uint32_t strip)
+                {
+                    const size_t begin = strip * s_ColumnStripWidth;
+                    const size_t end = std::min(row, begin + s_ColumnStripWidth);
+
+                    for (uint32_t y = 2; y <= m_Height; ++y)
+                    {
+                        T* current = m_Data.get() + static_cast<size_t>(y) * row;
+                        const T* previous = current - row;
+                        for (size_t i = begin; i < end; ++i) current[i] += previous[i];
+                    }
+                });
+        }
+
+        template<typename T>
+        void IntegralImage<T>::Clear()
+        {
+            m_Data.reset();
+            m_Width = m_Height = m_Channels = 0;
+        }
+
+        template class IntegralImage<uint32_t>;
+        template class IntegralImage<uint64_t>;
+
+        bool SummedAreaTable::NeedsWideAccumulators(uint32_t width, uint32_t height)
+        {
+            // 256 rather than 255 leaves room for the rounding term effects add to a full image sum
+            return static_cast<uint64_t>(width) * height * 256ULL > UINT32_MAX;
+        }
+
+        void SummedAreaTable::Build(const ImageBuffer& image, uint32_t threads)
+        {
+            m_Wide = NeedsWideAccumulators(image.GetWidth(), image.GetHeight());
+            if (m_Wide)
+            {
+                m_Table32.Clear();
+                m_Table64.Build(image, threads);
+            }
+            else
+            {
+                m_Table64.Clear();
+                m_Table32.Build(image, threads);
+            }
+        }
+
+    }
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "effects/imagebuffer.h"
+
+#include <memory>
+
+namespace saf {
+
+    namespace effects {
+
+        /*
+        * Summed area table of an 8 bit image, one running sum per channel.
+        * Stored with a zero top row and left column so a rectangle sum is always four loads, no edge cases:
+        *
+        *   Sum(x0, y0, x1, y1) = S(x1, y1) - S(x0, y1) - S(x1, y0) + S(x0, y0)      (half open, x0 <= x1, y0 <= y1)
+        */
+        template<typename T>
+        class IntegralImage
+        {
+        public:
+            void Build(const ImageBuffer& image, uint32_t threads = 0);
+            void Clear();
+
+            inline T At(uint32_t x, uint32_t y, uint32_t channel) const
+            {
+                return m_Data[(static_cast<size_t>(y) * (m_Width + 1) + x) * m_Channels + channel];
+            }
+
+            inline T Sum(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, uint32_t channel) const
+            {
+                return At(x1, y1, channel) - At(x0, y1, channel) - At(x1, y0, channel) + At(x0, y0, channel);
+            }
+
+            // Sums every channel of the rectangle at once, out must hold GetChannels() values.
+            inline void Sum(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, T* out) const
+            {
+                const size_t row = static_cast<size_t>(m_Width + 1) * m_Channels;
+                const T* top = m_Data.get() + static_cast<size_t>(y0) * row;
+                const T* bottom = m_Data.get() + static_cast<size_t>(y1) * row;
+                const size_t left = static_cast<size_t>(x0) * m_Channels, right = static_cast<size_t>(x1) * m_Channels;
+                for (uint32_t k = 0; k < m_Channels; ++k) out[k] = bottom[right + k] - bottom[left + k] - top[right + k] + top[left + k];
+            }
+
+            inline uint32_t GetWidth() const { return m_Width; }
+            inline uint32_t GetHeight() const { return m_Height; }
+            inline uint32_t GetChannels() const { return m_Channels; }
+
+        private:
+            std::unique_ptr<T[]> m_Data;
+            uint32_t m_Width = 0;
+            uint32_t m_Height = 0;
+            uint32_t m_Channels = 0;
+        };
+
+        /*
+        * Picks the accumulator width from the image size: 32 bit while a full image sum fits, 64 bit above that
+        * (~16.7 megapixels), halving table bandwidth for everything but the largest photos.
+        * Effect kernels call Visit() once and run their inner loop against the typed table.
+        */
+        class SummedAreaTable
+        {
+        public:
+            void Build(const ImageBuffer& image, uint32_t threads = 0);
+
+            static bool NeedsWideAccumulators(uint32_t width, uint32_t height);
+
+            inline bool IsWide() const { return m_Wide; }
+
+            template<typename Fn>
+            inline decltype(auto) Visit(Fn&& fn) const
+            {
+                return m_Wide ? fn(m_Table64) : fn(m_Table32);
+            }
+
+            inline uint64_t Sum(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, uint32_t channel) const
+            {
+                return m_Wide ? m_Table64.Sum(x0, y0, x1, y1, channel) : m_Table32.Sum(x0, y0, x1, y1, channel);
+            }
+
+        private:
+            bool m_Wide = false;
+            IntegralImage<uint32_t> m_Table32;
+            IntegralImage<uint64_t> m_Table64;
+        };
+
+    }
+
+}
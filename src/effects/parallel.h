@@ -0,0 +1,38 @@
+#pragma once
+
+#include <algorithm>
+#include <stdint.h>
+
+#include "globals.h"
+
+namespace saf {
+
+    namespace effects {
+
+        // 0 = every job system thread, capped at what the job system has and at the number of work items.
+        inline uint32_t ResolveThreadCount(uint32_t threads, uint32_t work_items)
+        {
+            const uint32_t available = global::g_JobSystem ? global::g_JobSystem->GetThreadCount() : 1;
+            if (threads == 0 || threads > available) threads = available;
+            return std::max(1U, std::min(threads, work_items));
+        }
+
+        // Calls fn(index) for every index < count on the calling thread plus up to threads - 1 job system workers.
+        // Runs inline when no job system is up.
+        template<typename Fn>
+        void ParallelFor(uint32_t count, uint32_t threads, Fn&& fn)
+        {
+            threads = ResolveThreadCount(threads, count);
+
+            if (global::g_JobSystem)
+            {
+                global::g_JobSystem->ParallelFor(count, threads, fn);
+                return;
+            }
+
+            for (uint32_t index = 0; index < count; ++index) fn(index);
+        }
+
+    }
+
+}
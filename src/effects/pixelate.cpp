@@ -0,0 +1,100 @@
+#include "safpch.h"
+#include "pixelate.h"
+
+#include "effects/parallel.h"
+#include "effects/pixelatekernels.h"
+
+namespace saf {
+
+    namespace effects {
+
+        // Tiles are a whole number of blocks, roughly this many pixels wide / high.
+        // Wide tiles keep row reads long and sequential, the height keeps enough tiles around to balance cores.
+        static constexpr uint32_t s_TargetTileWidth = 1024;
+        static constexpr uint32_t s_TargetTileHeight = 64;
+
+        struct TileScratch
+        {
+            std::vector<uint32_t> colsum;
+            std::vector<uint8_t> pattern;
+        };
+
+        static void PixelateTile(const PixelateKernels& kernels, ImageBuffer& image, uint32_t block, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, TileScratch& scratch)
+        {
+            const uint32_t channels = image.GetChannels();
+            const size_t span = static_cast<size_t>(x1 - x0) * channels;
+
+            const size_t stride = image.GetStride();
+            uint32_t* colsum = scratch.colsum.data();
+            uint8_t* pattern = scratch.pattern.data();
+
+            for (uint32_t by = y0; by < y1; by += block)
+            {
+                const uint32_t rows = std::min(block, y1 - by);
+
+                uint8_t* band = image.GetRow(by) + static_cast<size_t>(x0) * channels;
+
+                // Vertical pass: sum the band column-wise, every byte of the band is read exactly once
+                kernels.accumulate_rows(band, stride, rows, colsum, span);
+
+                // Horizontal pass: collapse each block's columns into a mean and lay it out as one output row.
+                // Tiles start on a block boundary, so the tile's blocks are the image's blocks.
+                kernels.collapse_blocks(colsum, pattern, span, block, channels, rows);
+
+                kernels.store_rows(band, stride, rows, pattern, span);
+            }
+        }
+
+        EffectStats Pixelate(ImageBuffer& image, uint32_t reduction, uint32_t threads)
+        {
+            EffectStats stats{};
+            if (image.Empty() || reduction <= 1) return stats;
+
+            if (image.GetChannels() > 4)
+            {
+                IFX_WARN("Pixelate does not support {0} channel images", image.GetChannels());
+                return stats;
+            }
+
+            const uint32_t width = image.GetWidth();
+            const uint32_t height = image.GetHeight();
+            const uint32_t block = std::min(reduction, std::max(width, height));
+
+            const uint32_t tile_width = std::max(1U, s_TargetTileWidth / block) * block;
+            const uint32_t tile_height = std::max(1U, s_TargetTileHeight / block) * block;
+            const uint32_t tiles_x = (width + tile_width - 1) / tile_width;
+            const uint32_t tiles_y = (height + tile_height - 1) / tile_height;
+            const uint32_t tile_count = tiles_x * tiles_y;
+
+            threads = ResolveThreadCount(threads, tile_count);
+
+            const PixelateKernels& kernels = GetPixelateKernels();
+
+            stats.tiles = tile_count;
+            stats.threads = threads;
+            stats.kernels = kernels.name;
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            const size_t scratch_size = static_cast<size_t>(std::min(tile_width, width)) * image.GetChannels();
+            ParallelFor(tile_count, threads, [&](uint32_t tile)
+                {
+                    thread_local TileScratch scratch;
+                    if (scratch.colsum.size() < scratch_size)
+                    {
+                        scratch.colsum.resize(scratch_size);
+                        scratch.pattern.resize(scratch_size);
+                    }
+
+                    const uint32_t x0 = (tile % tiles_x) * tile_width;
+                    const uint32_t y0 = (tile / tiles_x) * tile_height;
+                    PixelateTile(kernels, image, block, x0, y0, std::min(x0 + tile_width, width), std::min(y0 + tile_height, height), scratch);
+                });
+
+            stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            return stats;
+        }
+
+    }
+
+}
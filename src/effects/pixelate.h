@@ -0,0 +1,19 @@
+#pragma once
+
+#include "effects/imagebuffer.h"
+#include "effects/effectstats.h"
+
+namespace saf {
+
+    namespace effects {
+
+        /*
+        * Replaces every reduction x reduction block of the image with its rounded mean, in place.
+        * The image is cut into block aligned tiles which are handed out to threads (0 = all cores),
+        * so no block ever straddles two workers.
+        */
+        EffectStats Pixelate(ImageBuffer& image, uint32_t reduction, uint32_t threads = 0);
+
+    }
+
+}
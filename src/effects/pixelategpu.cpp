@@ -0,0 +1,149 @@
+#include "safpch.h"
+#include "pixelategpu.h"
+
+#include <cstring>
+
+#include "globals.h"
+#include "platform/vulkangraphics.h"
+#include "effects/pixelate.h"
+
+namespace saf {
+
+    namespace effects {
+
+        // Largest block whose channel sum still fits the shader's 32 bit accumulators: 4096^2 * 255 + rounding < 2^32
+        static constexpr uint32_t s_MaxGPUBlock = 4096;
+
+        struct PixelatePushConstant
+        {
+            uint32_t width;
+            uint32_t height;
+            uint32_t block;
+        };
+
+        PixelatePipeline::~PixelatePipeline()
+        {
+            Shutdown();
+        }
+
+        void PixelatePipeline::Init()
+        {
+            vk::DescriptorSetLayoutBinding desc_layout_binding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute);
+            vk::DescriptorSetLayoutCreateInfo desc_layout_info({}, desc_layout_binding);
+            m_vkDescriptorSetLayout = global::g_Device.createDescriptorSetLayout(desc_layout_info);
+
+            vk::PushConstantRange pushconstant_range(vk::ShaderStageFlagBits::eCompute, 0, sizeof(PixelatePushConstant));
+            vk::PipelineLayoutCreateInfo pipeline_layout_info({}, m_vkDescriptorSetLayout, pushconstant_range);
+            m_vkPipelineLayout = global::g_Device.createPipelineLayout(pipeline_layout_info);
+
+            vk::PipelineShaderStageCreateInfo shader_stage({}, vk::ShaderStageFlagBits::eCompute, vkhelper::CreateShaderModule(global::g_Device, "assets/shaders/pixelate.comp"), "main");
+            vk::PipelineCreationFeedback feedback;
+            m_vkPipeline = vkhelper::CreateComputePipeline(global::g_Device, global::g_PipelineCache->Get(), shader_stage, m_vkPipelineLayout, &feedback);
+            global::g_PipelineCache->Record("pixelate", feedback);
+            global::g_Device.destroyShaderModule(shader_stage.module);
+        }
+
+        void PixelatePipeline::Shutdown()
+        {
+            if (!m_vkPipeline) return;
+
+            global::g_Device.destroyPipeline(m_vkPipeline);
+            global::g_Device.destroyPipelineLayout(m_vkPipelineLayout);
+            global::g_Device.destroyDescriptorSetLayout(m_vkDescriptorSetLayout);
+
+            m_vkPipeline = nullptr;
+            m_vkPipelineLayout = nullptr;
+            m_vkDescriptorSetLayout = nullptr;
+        }
+
+        EffectStats PixelateGPU(const PixelatePipeline& pipeline, ImageBuffer& image, uint32_t reduction)
+        {
+            EffectStats stats{};
+            if (image.Empty() || reduction <= 1) return stats;
+
+            const uint32_t width = image.GetWidth();
+            const uint32_t height = image.GetHeight();
+            const uint32_t channels = image.GetChannels();
+            const uint32_t block = std::min(reduction, std::max(width, height));
+            const uint64_t buffer_size = image.GetPixelCount() * sizeof(uint32_t);
+
+            if (channels > 4 || block > s_MaxGPUBlock || buffer_size > UINT32_MAX)
+            {
+                IFX_WARN("PixelateGPU cannot run this image on the GPU, falling back to the CPU path");
+                return Pixelate(image, reduction);
+            }
+
+            const uint32_t groups_x = (width + block - 1) / block;
+            const uint32_t groups_y = (height + block - 1) / block;
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            // Host visible storage buffer, the shader reads and writes it in place so there is no staging copy either way
+            vma::Allocation allocation;
+            vk::Buffer buffer = vkhelper::create_buffer(static_cast<uint32_t>(buffer_size), vk::BufferUsageFlagBits::eStorageBuffer, vk::SharingMode::eExclusive, vma::MemoryUsage::eAutoPreferHost, vma::AllocationCreateFlagBits::eHostAccessRandom, global::g_Allocator, allocation);
+
+            uint8_t* pixels;
+            if (global::g_Allocator.mapMemory(allocation, reinterpret_cast<void**>(&pixels)) != vk::Result::eSuccess)
+                IFX_ERROR("Failed to map pixelate buffer");
+
+            // Expand to RGBA8, unused channels stay zero and never reach the output
+            const uint8_t* src = image.GetData();
+            if (channels == 4) std::memcpy(pixels, src, buffer_size);
+            else
+            {
+                std::memset(pixels, 0, buffer_size);
+                for (uint64_t i = 0; i < image.GetPixelCount(); ++i)
+                {
+                    for (uint32_t k = 0; k < channels; ++k) pixels[i * 4 + k] = src[i * channels + k];
+                }
+            }
+            (void)global::g_Allocator.flushAllocation(allocation, 0, VK_WHOLE_SIZE);
+
+            vk::DescriptorSetAllocateInfo desc_alloc_info(global::g_DescriptorPool, pipeline.m_vkDescriptorSetLayout);
+            vk::DescriptorSet desc_set = global::g_Device.allocateDescriptorSets(desc_alloc_info)[0];
+
+            vk::DescriptorBufferInfo desc_buffer_info(buffer, 0, VK_WHOLE_SIZE);
+            vk::WriteDescriptorSet desc_set_write(desc_set, 0, 0, vk::DescriptorType::eStorageBuffer, {}, desc_buffer_info);
+            global::g_Device.updateDescriptorSets(desc_set_write, {});
+
+            const PixelatePushConstant push_constant{ width, height, block };
+
+            vkhelper::immediate_submit(global::g_Device, global::g_ComputeQueueIndex, [&](vk::CommandBuffer cmd)
+                {
+                    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline.m_vkPipeline);
+                    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeline.m_vkPipelineLayout, 0, desc_set, {});
+                    cmd.pushConstants(pipeline.m_vkPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(PixelatePushConstant), &push_constant);
+                    cmd.dispatch(groups_x, groups_y, 1);
+
+                    vk::BufferMemoryBarrier barrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eHostRead, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, buffer, 0, VK_WHOLE_SIZE);
+                    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, {}, {}, barrier, {});
+                });
+
+            (void)global::g_Allocator.invalidateAllocation(allocation, 0, VK_WHOLE_SIZE);
+
+            uint8_t* dst = image.GetData();
+            if (channels == 4) std::memcpy(dst, pixels, buffer_size);
+            else
+            {
+                for (uint64_t i = 0; i < image.GetPixelCount(); ++i)
+                {
+                    for (uint32_t k = 0; k < channels; ++k) dst[i * channels + k] = pixels[i * 4 + k];
+                }
+            }
+
+            global::g_Allocator.unmapMemory(allocation);
+            global::g_Allocator.destroyBuffer(buffer, allocation);
+
+            stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            stats.tiles = groups_x * groups_y;
+            stats.threads = 1;
+            stats.kernels = "vulkan";
+
+            global::g_Device.freeDescriptorSets(global::g_DescriptorPool, desc_set);
+
+            return stats;
+        }
+
+    }
+
+}
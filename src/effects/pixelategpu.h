@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include "effects/imagebuffer.h"
+#include "effects/effectstats.h"
+
+namespace saf {
+
+    namespace effects {
+
+        /*
+        * Compute pipeline for assets/shaders/pixelate.comp, built once through global::g_PipelineCache.
+        * Needs a live Vulkan device in saf::global (Window or ComputeDevice) and must be shut down before it.
+        */
+        class PixelatePipeline
+        {
+        public:
+            PixelatePipeline() = default;
+            PixelatePipeline(const PixelatePipeline&) = delete;
+            PixelatePipeline(PixelatePipeline&&) = delete;
+            PixelatePipeline& operator=(const PixelatePipeline&) = delete;
+            PixelatePipeline& operator=(PixelatePipeline&&) = delete;
+            ~PixelatePipeline();
+
+            void Init();
+            void Shutdown();
+
+        private:
+            friend EffectStats PixelateGPU(const PixelatePipeline& pipeline, ImageBuffer& image, uint32_t reduction);
+
+            vk::DescriptorSetLayout m_vkDescriptorSetLayout = nullptr;
+            vk::PipelineLayout m_vkPipelineLayout = nullptr;
+            vk::Pipeline m_vkPipeline = nullptr;
+        };
+
+        /*
+        * Pixelate on the GPU, one workgroup per block, output is bit-exact with Pixelate().
+        * Falls back to the CPU path for blocks too large for the 32 bit shader sums.
+        */
+        EffectStats PixelateGPU(const PixelatePipeline& pipeline, ImageBuffer& image, uint32_t reduction);
+
+    }
+
+}
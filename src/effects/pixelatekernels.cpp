@@ -0,0 +1,391 @@
+#include "safpch.h"
+#include "pixelatekernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "utils/cpufeatures.h"
+
+#ifdef SAF_X86
+    #include <immintrin.h>
+#endif
+
+namespace saf {
+
+    namespace effects {
+
+        static void AccumulateRowsScalar(const uint8_t* src, size_t stride, uint32_t rows, uint32_t* colsum, size_t n)
+        {
+            memset(colsum, 0, n * sizeof(uint32_t));
+            for (uint32_t r = 0; r < rows; ++r)
+            {
+                const uint8_t* row = src + r * stride;
+                for (size_t i = 0; i < n; ++i) colsum[i] += row[i];
+            }
+        }
+
+        static void CollapseBlocksScalar(const uint32_t* colsum, uint8_t* pattern, size_t span, uint32_t block, uint32_t channels, uint32_t rows)
+        {
+            const size_t block_span = static_cast<size_t>(block) * channels;
+            for (size_t offset = 0; offset < span; offset += block_span)
+            {
+                const size_t n = std::min(block_span, span - offset);
+                const uint64_t count = static_cast<uint64_t>(n / channels) * rows;
+
+                uint64_t sum[4] = { 0, 0, 0, 0 };
+                for (size_t i = 0; i < n; ++i) sum[i % channels] += colsum[offset + i];
+
+                uint8_t mean[4];
+                for (uint32_t k = 0; k < channels; ++k) mean[k] = static_cast<uint8_t>((sum[k] + count / 2) / count);
+
+                for (size_t i = 0; i < n; ++i) pattern[offset + i] = mean[i % channels];
+            }
+        }
+
+        static void StoreRowsScalar(uint8_t* dst, size_t stride, uint32_t rows, const uint8_t* pattern, size_t n)
+        {
+            for (uint32_t r = 0; r < rows; ++r) memcpy(dst + r * stride, pattern, n);
+        }
+
+        // Writes the block's mean pixel once, then doubles the filled prefix, which stays a whole number of pixels
+        static inline void FillBlock(uint8_t* pattern, size_t n, uint32_t channels, const uint64_t sum[4], uint64_t count)
+        {
+            for (uint32_t k = 0; k < channels; ++k) pattern[k] = static_cast<uint8_t>((sum[k] + count / 2) / count);
+            for (size_t filled = channels; filled < n;)
+            {
+                const size_t copied = std::min(filled, n - filled);
+                memcpy(pattern + filled, pattern, copied);
+                filled += copied;
+            }
+        }
+
+        // Adds the 64 bit lanes of a period that is a multiple of channels into the per channel sums
+        static inline void ReduceLanes(const uint64_t* lanes, size_t period, uint32_t channels, uint64_t sum[4])
+        {
+            for (size_t j = 0; j < period; ++j) sum[j % channels] += lanes[j];
+        }
+
+#ifdef SAF_X86
+
+        SAF_TARGET("sse4.1")
+        static void AccumulateRowsSSE41(const uint8_t* src, size_t stride, uint32_t rows, uint32_t* colsum, size_t n)
+        {
+            memset(colsum, 0, n * sizeof(uint32_t));
+            const size_t simd_n = n & ~static_cast<size_t>(15);
+
+            for (uint32_t r = 0; r < rows; ++r)
+            {
+                const uint8_t* row = src + r * stride;
+                size_t i = 0;
+                for (; i < simd_n; i += 16)
+                {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+                    __m128i* acc = reinterpret_cast<__m128i*>(colsum + i);
+                    _mm_storeu_si128(acc + 0, _mm_add_epi32(_mm_loadu_si128(acc + 0), _mm_cvtepu8_epi32(v)));
+                    _mm_storeu_si128(acc + 1, _mm_add_epi32(_mm_loadu_si128(acc + 1), _mm_cvtepu8_epi32(_mm_srli_si128(v, 4))));
+                    _mm_storeu_si128(acc + 2, _mm_add_epi32(_mm_loadu_si128(acc + 2), _mm_cvtepu8_epi32(_mm_srli_si128(v, 8))));
+                    _mm_storeu_si128(acc + 3, _mm_add_epi32(_mm_loadu_si128(acc + 3), _mm_cvtepu8_epi32(_mm_srli_si128(v, 12))));
+                }
+                for (; i < n; ++i) colsum[i] += row[i];
+            }
+        }
+
+        // Block sums are 64 bit, a wide block of bright pixels overflows 32. Lanes repeat every period values,
+        // a multiple of both channels and the vector width, so every lane belongs to one channel.
+        SAF_TARGET("sse4.1")
+        static void CollapseBlocksSSE41(const uint32_t* colsum, uint8_t* pattern, size_t span, uint32_t block, uint32_t channels, uint32_t rows)
+        {
+            const size_t period = channels == 3 ? 6 : (channels == 1 ? 2 : channels);
+            const size_t block_span = static_cast<size_t>(block) * channels;
+            for (size_t offset = 0; offset < span; offset += block_span)
+            {
+                const size_t n = std::min(block_span, span - offset);
+                const uint32_t* values = colsum + offset;
+
+                __m128i acc[3] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+                size_t i = 0;
+                for (; i + period <= n; i += period)
+                {
+                    for (size_t v = 0; v < period / 2; ++v)
+                        acc[v] = _mm_add_epi64(acc[v], _mm_cvtepu32_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(values + i + v * 2))));
+                }
+
+                alignas(16) uint64_t lanes[6];
+                for (size_t v = 0; v < period / 2; ++v) _mm_store_si128(reinterpret_cast<__m128i*>(lanes + v * 2), acc[v]);
+
+                uint64_t sum[4] = { 0, 0, 0, 0 };
+                ReduceLanes(lanes, period, channels, sum);
+                for (; i < n; ++i) sum[i % channels] += values[i];
+
+                FillBlock(pattern + offset, n, channels, sum, static_cast<uint64_t>(n / channels) * rows);
+            }
+        }
+
+        SAF_TARGET("sse4.1")
+        static void StoreRowsSSE41(uint8_t* dst, size_t stride, uint32_t rows, const uint8_t* pattern, size_t n)
+        {
+            const size_t simd_n = n & ~static_cast<size_t>(15);
+
+            for (uint32_t r = 0; r < rows; ++r)
+            {
+                uint8_t* row = dst + r * stride;
+                size_t i = 0;
+                for (; i < simd_n; i += 16)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + i)));
+                }
+                if (i < n) memcpy(row + i, pattern + i, n - i);
+            }
+        }
+
+        SAF_TARGET("avx2")
+        static void AccumulateRowsAVX2(const uint8_t* src, size_t stride, uint32_t rows, uint32_t* colsum, size_t n)
+        {
+            memset(colsum, 0, n * sizeof(uint32_t));
+            const size_t simd_n = n & ~static_cast<size_t>(31);
+
+            for (uint32_t r = 0; r < rows; ++r)
+            {
+                const uint8_t* row = src + r * stride;
+                size_t i = 0;
+                for (; i < simd_n; i += 32)
+                {
+                    __m256i* acc = reinterpret_cast<__m256i*>(colsum + i);
+                    for (int q = 0; q < 4; ++q)
+                    {
+                        const __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + i + q * 8)));
+                        _mm256_storeu_si256(acc + q, _mm256_add_epi32(_mm256_loadu_si256(acc + q), v));
+                    }
+                }
+                for (; i < n; ++i) colsum[i] += row[i];
+            }
+        }
+
+        SAF_TARGET("avx2")
+        static void CollapseBlocksAVX2(const uint32_t* colsum, uint8_t* pattern, size_t span, uint32_t block, uint32_t channels, uint32_t rows)
+        {
+            const size_t period = channels == 3 ? 12 : 4;
+            const size_t block_span = static_cast<size_t>(block) * channels;
+            for (size_t offset = 0; offset < span; offset += block_span)
+            {
+                const size_t n = std::min(block_span, span - offset);
+                const uint32_t* values = colsum + offset;
+
+                __m256i acc[3] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+                size_t i = 0;
+                for (; i + period <= n; i += period)
+                {
+                    for (size_t v = 0; v < period / 4; ++v)
+                        acc[v] = _mm256_add_epi64(acc[v], _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + v * 4))));
+                }
+
+                alignas(32) uint64_t lanes[12];
+                for (size_t v = 0; v < period / 4; ++v) _mm256_store_si256(reinterpret_cast<__m256i*>(lanes + v * 4), acc[v]);
+
+                uint64_t sum[4] = { 0, 0, 0, 0 };
+                ReduceLanes(lanes, period, channels, sum);
+                for (; i < n; ++i) sum[i % channels] += values[i];
+
+                FillBlock(pattern + offset, n, channels, sum, static_cast<uint64_t>(n / channels) * rows);
+            }
+        }
+
+        SAF_TARGET("avx2")
+        static void StoreRowsAVX2(uint8_t* dst, size_t stride, uint32_t rows, const uint8_t* pattern, size_t n)
+        {
+            const size_t simd_n = n & ~static_cast<size_t>(31);
+
+            for (uint32_t r = 0; r < rows; ++r)
+            {
+                uint8_t* row = dst + r * stride;
+                size_t i = 0;
+                for (; i < simd_n; i += 32)
+                {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + i), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern + i)));
+                }
+                if (i < n) memcpy(row + i, pattern + i, n - i);
+            }
+        }
+
+        SAF_TARGET("avx512f")
+        static void AccumulateRowsAVX512(const uint8_t* src, size_t stride, uint32_t rows, uint32_t* colsum, size_t n)
+        {
+            memset(colsum, 0, n * sizeof(uint32_t));
+            const size_t simd_n = n & ~static_cast<size_t>(63);
+
+            for (uint32_t r = 0; r < rows; ++r)
+            {
+                const uint8_t* row = src + r * stride;
+                size_t i = 0;
+                for (; i < simd_n; i += 64)
+                {
+                    for (int q = 0; q < 4; ++q)
+                    {
+                        uint32_t* acc = colsum + i + q * 16;
+                        const __m512i v = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i + q * 16)));
+                        _mm512_storeu_si512(acc, _mm512_add_epi32(_mm512_loadu_si512(acc), v));
+                    }
+                }
+                for (; i < n; ++i) colsum[i] += row[i];
+            }
+        }
+
+        SAF_TARGET("avx512f")
+        static void CollapseBlocksAVX512(const uint32_t* colsum, uint8_t* pattern, size_t span, uint32_t block, uint32_t channels, uint32_t rows)
+        {
+            const size_t period = channels == 3 ? 24 : 8;
+            const size_t block_span = static_cast<size_t>(block) * channels;
+            for (size_t offset = 0; offset < span; offset += block_span)
+            {
+                const size_t n = std::min(block_span, span - offset);
+                const uint32_t* values = colsum + offset;
+
+                __m512i acc[3] = { _mm512_setzero_si512(), _mm512_setzero_si512(), _mm512_setzero_si512() };
+                size_t i = 0;
+                for (; i + period <= n; i += period)
+                {
+                    for (size_t v = 0; v < period / 8; ++v)
+                        acc[v] = _mm512_add_epi64(acc[v], _mm512_cvtepu32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + v * 8))));
+                }
+
+                alignas(64) uint64_t lanes[24];
+                for (size_t v = 0; v < period / 8; ++v) _mm512_store_si512(lanes + v * 8, acc[v]);
+
+                uint64_t sum[4] = { 0, 0, 0, 0 };
+                ReduceLanes(lanes, period, channels, sum);
+                for (; i < n; ++i) sum[i % channels] += values[i];
+
+                FillBlock(pattern + offset, n, channels, sum, static_cast<uint64_t>(n / channels) * rows);
+            }
+        }
+
+        SAF_TARGET("avx512f")
+        static void StoreRowsAVX512(uint8_t* dst, size_t stride, uint32_t rows, const uint8_t* pattern, size_t n)
+        {
+            const size_t simd_n = n & ~static_cast<size_t>(63);
+
+            for (uint32_t r = 0; r < rows; ++r)
+            {
+                uint8_t* row = dst + r * stride;
+                size_t i = 0;
+                for (; i < simd_n; i += 64)
+                {
+                    _mm512_storeu_si512(row + i, _mm512_loadu_si512(pattern + i));
+                }
+                if (i < n) memcpy(row + i, pattern + i, n - i);
+            }
+        }
+
+        static const PixelateKernels s_SSE41Kernels{ "sse4.1", AccumulateRowsSSE41, CollapseBlocksSSE41, StoreRowsSSE41 };
+        static const PixelateKernels s_AVX2Kernels{ "avx2", AccumulateRowsAVX2, CollapseBlocksAVX2, StoreRowsAVX2 };
+        static const PixelateKernels s_AVX512Kernels{ "avx512", AccumulateRowsAVX512, CollapseBlocksAVX512, StoreRowsAVX512 };
+
+#endif
+
+        static const PixelateKernels s_ScalarKernels{ "scalar", AccumulateRowsScalar, CollapseBlocksScalar, StoreRowsScalar };
+
+        std::vector<const PixelateKernels*> GetSupportedPixelateKernels()
+        {
+            std::vector<const PixelateKernels*> kernels{ &s_ScalarKernels };
+#ifdef SAF_X86
+            const CpuFeatures& cpu = GetCpuFeatures();
+            if (cpu.sse41) kernels.push_back(&s_SSE41Kernels);
+            if (cpu.avx2) kernels.push_back(&s_AVX2Kernels);
+            if (cpu.avx512f) kernels.push_back(&s_AVX512Kernels);
+#endif
+            return kernels;
+        }
+
+        const PixelateKernels& GetScalarPixelateKernels()
+        {
+            return s_ScalarKernels;
+        }
+
+        bool ValidatePixelateKernels()
+        {
+            const size_t stride = 301;
+            const uint32_t rows = 37;
+            std::vector<uint8_t> src(stride * rows);
+            uint32_t seed = 0x9E3779B9U;
+            for (uint8_t& b : src)
+            {
+                seed = seed * 1664525U + 1013904223U;
+                b = static_cast<uint8_t>(seed >> 24);
+            }
+
+            bool valid = true;
+            for (size_t n : { static_cast<size_t>(1), static_cast<size_t>(15), static_cast<size_t>(64), static_cast<size_t>(127), static_cast<size_t>(297) })
+            {
+                std::vector<uint32_t> expected_sum(n), sum(n);
+                std::vector<uint8_t> expected_rows(src.size(), 0), out_rows(src.size(), 0);
+
+                s_ScalarKernels.accumulate_rows(src.data(), stride, rows, expected_sum.data(), n);
+                s_ScalarKernels.store_rows(expected_rows.data(), stride, rows, src.data(), n);
+
+                for (const PixelateKernels* kernels : GetSupportedPixelateKernels())
+                {
+                    std::fill(out_rows.begin(), out_rows.end(), 0);
+                    kernels->accumulate_rows(src.data(), stride, rows, sum.data(), n);
+                    kernels->store_rows(out_rows.data(), stride, rows, src.data(), n);
+
+                    if (sum != expected_sum || out_rows != expected_rows)
+                    {
+                        IFX_WARN("Pixelate {0} row kernels differ from scalar reference (n = {1})", kernels->name, n);
+                        valid = false;
+                    }
+                }
+            }
+
+            // Column sums of a band_rows tall band, 255 * band_rows * 5000 is past 2^32 so the widest block overflows 32 bit sums
+            const uint32_t band_rows = 20000;
+            for (uint32_t channels = 1; channels <= 4; ++channels)
+            {
+                for (uint32_t block : { 1U, 2U, 7U, 16U, 33U, 5000U })
+                {
+                    for (uint32_t pixels : { 1U, 9U, 64U, 101U, 12001U })
+                    {
+                        const size_t span = static_cast<size_t>(pixels) * channels;
+                        std::vector<uint32_t> colsum(span);
+                        for (uint32_t& value : colsum)
+                        {
+                            seed = seed * 1664525U + 1013904223U;
+                            value = (seed >> 8) % (255U * band_rows + 1U);
+                        }
+
+                        std::vector<uint8_t> expected(span), out(span);
+                        s_ScalarKernels.collapse_blocks(colsum.data(), expected.data(), span, block, channels, band_rows);
+
+                        for (const PixelateKernels* kernels : GetSupportedPixelateKernels())
+                        {
+                            std::fill(out.begin(), out.end(), 0);
+                            kernels->collapse_blocks(colsum.data(), out.data(), span, block, channels, band_rows);
+                            if (out != expected)
+                            {
+                                IFX_WARN("Pixelate {0} collapse kernel differs from scalar reference (channels = {1}, block = {2}, pixels = {3})", kernels->name, channels, block, pixels);
+                                valid = false;
+                            }
+                        }
+                    }
+                }
+            }
+
+            return valid;
+        }
+
+        const PixelateKernels& GetPixelateKernels()
+        {
+            static const PixelateKernels& kernels = []() -> const PixelateKernels&
+                {
+#ifdef SAF_DEBUG
+                    if (!ValidatePixelateKernels()) IFX_ERROR("Pixelate kernels differ from scalar reference");
+#endif
+                    const PixelateKernels& selected = *GetSupportedPixelateKernels().back();
+                    IFX_TRACE("Pixelate using {0} kernels", selected.name);
+                    return selected;
+                }();
+            return kernels;
+        }
+
+    }
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace saf {
+
+    namespace effects {
+
+        /*
+        * Bandwidth bound inner loops of the pixelate band pass, working on raw interleaved bytes so the
+        * same kernel serves 1, 2, 3 and 4 channel images.
+        *
+        * accumulate_rows: colsum[i] = sum of src[r * stride + i] over r < rows, for i < n (overwrites colsum)
+        * collapse_blocks: splits colsum[0, span) into blocks of block pixels (the last one may be narrower) and sets every
+        *                  pattern byte of a block to its channel's rounded mean, the sum of the block's colsums over pixels * rows
+        * store_rows:      dst[r * stride + i] = pattern[i] for r < rows, i < n
+        *
+        * Every implementation is integer exact, so all of them produce bit identical output to the scalar one.
+        */
+        struct PixelateKernels
+        {
+            const char* name;
+            void (*accumulate_rows)(const uint8_t* src, size_t stride, uint32_t rows, uint32_t* colsum, size_t n);
+            void (*collapse_blocks)(const uint32_t* colsum, uint8_t* pattern, size_t span, uint32_t block, uint32_t channels, uint32_t rows);
+            void (*store_rows)(uint8_t* dst, size_t stride, uint32_t rows, const uint8_t* pattern, size_t n);
+        };
+
+        // Widest kernel set the CPU supports, picked once from CPUID.
+        const PixelateKernels& GetPixelateKernels();
+
+        const PixelateKernels& GetScalarPixelateKernels();
+
+        // Every kernel set usable on this CPU, scalar first.
+        std::vector<const PixelateKernels*> GetSupportedPixelateKernels();
+
+        // Runs every supported kernel set against the scalar one on awkward sizes, logs and returns false on any difference.
+        bool ValidatePixelateKernels();
+
+    }
+
+}
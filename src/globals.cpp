@@ -16,17 +16,25 @@ namespace saf {
 
 		vk::Queue g_GraphicsQueue;
 
+		uint32_t g_ComputeQueueIndex;
+		vk::Queue g_ComputeQueue;
+
 		vk::SurfaceKHR g_Surface;
 		vk::SurfaceFormatKHR g_SurfaceFormat;
 		vk::DebugUtilsMessengerEXT g_Messenger;
 		vma::Allocator g_Allocator;
 		vk::DescriptorPool g_DescriptorPool;
+		std::shared_ptr<PipelineCache> g_PipelineCache;
 
 		std::vector<const char*> g_Layers{};
 		std::vector<const char*> g_Extensions{};
 
+		const char* g_PipelineCachePath = "cache/pipelines.bin";
+
 		std::shared_ptr<const Input> g_Input;
 		std::shared_ptr<const Window> g_Window;
+
+		std::shared_ptr<JobSystem> g_JobSystem;
 	}
 
 }
\ No newline at end of file
@@ -4,7 +4,9 @@
 #include <vk_mem_alloc.hpp>
 
 #include "core/input.h"
+#include "core/jobsystem.h"
 #include "core/window.h"
+#include "render/pipelinecache.h"
 
 namespace saf {
 
@@ -21,16 +23,24 @@ namespace saf {
 
 		extern vk::Queue g_GraphicsQueue;
 
+		extern uint32_t g_ComputeQueueIndex;
+		extern vk::Queue g_ComputeQueue;
+
 		extern vk::SurfaceKHR g_Surface;
 		extern vk::SurfaceFormatKHR g_SurfaceFormat;
 		extern vma::Allocator g_Allocator;
 		extern vk::DescriptorPool g_DescriptorPool;
+		extern std::shared_ptr<PipelineCache> g_PipelineCache;
 
 		extern std::vector<const char*> g_Layers;
 		extern std::vector<const char*> g_Extensions;
 
+		extern const char* g_PipelineCachePath;
+
 		extern std::shared_ptr<const Input> g_Input;
 		extern std::shared_ptr<const Window> g_Window;
+
+		extern std::shared_ptr<JobSystem> g_JobSystem;
 	}
 
 }
\ No newline at end of file
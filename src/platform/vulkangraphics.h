@@ -1,12 +1,15 @@
 #pragma once
 
 #include <vulkan/vulkan.hpp>
+#ifdef SAF_RUNTIME_SHADERC
 #include <shaderc/shaderc.h>
+#endif
 #include <fstream>
-#include <GLFW/glfw3.h>
 
 #include <vk_mem_alloc.hpp>
 
+#include "render/embeddedshaders.h"
+
 namespace saf {
 
 	namespace vkhelper {
@@ -43,10 +46,10 @@ namespace saf {
                 bool has_flags = false;
 
                 if (qfp.queueFlags & flags) has_flags = true;
+                // Headless callers pass a null surface and only get the flags checked
                 if (surface && physical_device)
                 {
-                    //if (m_vkPhysicalDevice.getSurfaceSupportKHR(i, surface) == VK_SUCCESS) can_preset = true;
-                    if (glfwGetPhysicalDevicePresentationSupport(static_cast<VkInstance>(instance), static_cast<VkPhysicalDevice>(physical_device), i) == GLFW_TRUE) can_preset = true;
+                    if (physical_device.getSurfaceSupportKHR(i, surface)) can_preset = true;
                 }
 
                 if (has_flags && (can_preset || !surface))
@@ -95,7 +98,8 @@ namespace saf {
             std::vector<vk::PipelineColorBlendAttachmentState> const& blend_attachment_states,
             vk::PipelineDepthStencilStateCreateInfo const&            depth_stencil_state,
             vk::PipelineLayout                                        pipeline_layout,
-            vk::Format                                                swapchain_format)
+            vk::Format                                                swapchain_format,
+            vk::PipelineCreationFeedback*                             feedback = nullptr)
         {
             vk::PipelineInputAssemblyStateCreateInfo input_assembly_state({}, primitive_topology, false);
 
@@ -138,6 +142,10 @@ namespace saf {
             );
             pipeline_create_info.pNext = &pipeline_rendering_create_info;
 
+            // Whole pipeline feedback only, it tells us whether the pipeline cache was hit
+            vk::PipelineCreationFeedbackCreateInfo feedback_create_info(feedback);
+            if (feedback) pipeline_rendering_create_info.pNext = &feedback_create_info;
+
             vk::Result   result;
             vk::Pipeline pipeline;
             std::tie(result, pipeline) = device.createGraphicsPipeline(pipeline_cache, pipeline_create_info);
@@ -145,8 +153,29 @@ namespace saf {
             return pipeline;
         }
 
+        [[nodiscard]] inline vk::Pipeline CreateComputePipeline(
+            vk::Device                                                device,
+            vk::PipelineCache                                         pipeline_cache,
+            vk::PipelineShaderStageCreateInfo const&                  shader_stage,
+            vk::PipelineLayout                                        pipeline_layout,
+            vk::PipelineCreationFeedback*                             feedback = nullptr)
+        {
+            vk::ComputePipelineCreateInfo pipeline_create_info({}, shader_stage, pipeline_layout);
+
+            vk::PipelineCreationFeedbackCreateInfo feedback_create_info(feedback);
+            if (feedback) pipeline_create_info.pNext = &feedback_create_info;
+
+            vk::Result   result;
+            vk::Pipeline pipeline;
+            std::tie(result, pipeline) = device.createComputePipeline(pipeline_cache, pipeline_create_info);
+            assert(result == vk::Result::eSuccess);
+            return pipeline;
+        }
+
+        // Embedded SPIR-V by default, SAF_RUNTIME_SHADERC compiles the GLSL in assets/shaders on the fly instead (shader development)
         [[nodiscard]] inline vk::ShaderModule CreateShaderModule(vk::Device device, std::string path)
         {
+#ifdef SAF_RUNTIME_SHADERC
             static const std::map<std::string, shaderc_shader_kind> shader_stage_map = { {"comp", shaderc_shader_kind::shaderc_compute_shader},
                                                                                             {"frag", shaderc_shader_kind::shaderc_fragment_shader},
                                                                                             {"geom", shaderc_shader_kind::shaderc_geometry_shader},
@@ -167,8 +196,6 @@ namespace saf {
                 file_contents.push_back('\n');
             }
 
-            IFX_TRACE("Shader src:\n{0}", file_contents);
-
             std::string file_ext = path;
 
             // Extract extension name from the glsl shader file
@@ -181,16 +208,25 @@ namespace saf {
                 IFX_ERROR("Vulkan file extension {0} does not have a vulkan shader stage.", file_ext);
             }
             shaderc_compilation_result_t compilation_result = shaderc_compile_into_spv(compiler, file_contents.c_str(), file_contents.size(), stageIt->second, path.c_str(), "main", nullptr);
-            if (shaderc_result_get_compilation_status(compilation_result) != shaderc_compilation_status_success) IFX_ERROR("ShaderC failed to compile: {0}", path);
+            if (shaderc_result_get_compilation_status(compilation_result) != shaderc_compilation_status_success) IFX_ERROR("ShaderC failed to compile: {0}\n{1}", path, shaderc_result_get_error_message(compilation_result));
 
             size_t length = shaderc_result_get_length(compilation_result);
             const uint32_t* spirv = (const uint32_t*)shaderc_result_get_bytes(compilation_result);
 
             vk::ShaderModuleCreateInfo shader_module_create_info({}, length, spirv);
+            vk::ShaderModule shader_module = device.createShaderModule(shader_module_create_info);
 
+            shaderc_result_release(compilation_result);
             shaderc_compiler_release(compiler);
 
+            return shader_module;
+#else
+            const shaders::EmbeddedShader* shader = shaders::FindEmbeddedShader(path);
+            if (!shader) IFX_ERROR("Shader {0} was not compiled into the binary, is it in assets/shaders?", path);
+
+            vk::ShaderModuleCreateInfo shader_module_create_info({}, shader->size, shader->code);
             return device.createShaderModule(shader_module_create_info);
+#endif
         }
 
         [[nodiscard]] inline vk::Instance CreateInstance(const std::vector<const char*>& extensions, const std::vector<const char*>& layers)
@@ -336,7 +372,8 @@ namespace saf {
             return physical_device;
         }
 
-        [[nodiscard]] inline vk::Device CreateLogicalDevice(vk::Instance instance, vk::PhysicalDevice physical_device, uint32_t graphics_queue_family, std::vector<const char*> layers = {}, std::vector<const char*> extensions = {})
+        // descriptor_indexing enables what the bindless image array of Renderer2D needs, and fails clearly on devices without it
+        [[nodiscard]] inline vk::Device CreateLogicalDevice(vk::Instance instance, vk::PhysicalDevice physical_device, uint32_t graphics_queue_family, std::vector<const char*> layers = {}, std::vector<const char*> extensions = {}, bool descriptor_indexing = false)
         {
 
             const float queue_priority = 1.f;
@@ -345,8 +382,31 @@ namespace saf {
             device_features.samplerAnisotropy = vk::True;
             device_features.fillModeNonSolid = vk::True;
 
+            vk::PhysicalDeviceVulkan12Features device_vulkan12_features{};
             vk::PhysicalDeviceDynamicRenderingFeatures device_dynamic_features{};
             device_dynamic_features.dynamicRendering = VK_TRUE;
+
+            if (descriptor_indexing)
+            {
+                const vk::PhysicalDeviceVulkan12Features supported = physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>().get<vk::PhysicalDeviceVulkan12Features>();
+
+                std::string missing;
+                if (!supported.descriptorIndexing) missing += " descriptorIndexing";
+                if (!supported.runtimeDescriptorArray) missing += " runtimeDescriptorArray";
+                if (!supported.descriptorBindingPartiallyBound) missing += " descriptorBindingPartiallyBound";
+                if (!supported.descriptorBindingSampledImageUpdateAfterBind) missing += " descriptorBindingSampledImageUpdateAfterBind";
+                if (!supported.descriptorBindingUpdateUnusedWhilePending) missing += " descriptorBindingUpdateUnusedWhilePending";
+                if (!supported.shaderSampledImageArrayNonUniformIndexing) missing += " shaderSampledImageArrayNonUniformIndexing";
+                if (!missing.empty()) IFX_ERROR("Vulkan device {0} lacks descriptor indexing features Renderer2D needs:{1}", physical_device.getProperties().deviceName.data(), missing);
+
+                device_vulkan12_features.descriptorIndexing = VK_TRUE;
+                device_vulkan12_features.runtimeDescriptorArray = VK_TRUE;
+                device_vulkan12_features.descriptorBindingPartiallyBound = VK_TRUE;
+                device_vulkan12_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+                device_vulkan12_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+                device_vulkan12_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+                device_dynamic_features.pNext = &device_vulkan12_features;
+            }
             const vk::DeviceCreateInfo device_create_info(
                 {},
                 1,
@@ -371,6 +431,53 @@ namespace saf {
             return device;
         }
 
+        [[nodiscard]] inline vma::Allocator CreateAllocator(vk::Instance instance, vk::PhysicalDevice physical_device, vk::Device device)
+        {
+            vma::VulkanFunctions vulkanFunctions = {};
+            vulkanFunctions.vkGetInstanceProcAddr = VULKAN_HPP_DEFAULT_DISPATCHER.vkGetInstanceProcAddr;
+            vulkanFunctions.vkGetDeviceProcAddr = VULKAN_HPP_DEFAULT_DISPATCHER.vkGetDeviceProcAddr;
+
+            vma::AllocatorCreateInfo vma_alloc_create_info = {};
+            vma_alloc_create_info.device = device;
+            vma_alloc_create_info.flags = {};
+            vma_alloc_create_info.instance = instance;
+            vma_alloc_create_info.physicalDevice = physical_device;
+            vma_alloc_create_info.vulkanApiVersion = VK_API_VERSION_1_3;
+            vma_alloc_create_info.pVulkanFunctions = &vulkanFunctions;
+
+            vma::Allocator allocator;
+            if (vma::createAllocator(&vma_alloc_create_info, &allocator) != vk::Result::eSuccess)
+                IFX_ERROR("Failed to create allocator");
+
+            return allocator;
+        }
+
+        [[nodiscard]] inline vk::DescriptorPool CreateDescriptorPool(vk::Device device)
+        {
+            std::array<vk::DescriptorPoolSize, 11> pool_sizes =
+            {
+                vk::DescriptorPoolSize(vk::DescriptorType::eSampler, 100),
+                vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 100),
+                vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, 100),
+                vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, 100),
+                vk::DescriptorPoolSize(vk::DescriptorType::eUniformTexelBuffer, 100),
+                vk::DescriptorPoolSize(vk::DescriptorType::eStorageTexelBuffer, 100),
+                vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, 100),
+                vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 100),
+                vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, 100),
+                vk::DescriptorPoolSize(vk::DescriptorType::eStorageBufferDynamic, 100),
+                vk::DescriptorPoolSize(vk::DescriptorType::eInputAttachment, 100)
+            };
+
+            vk::DescriptorPoolCreateInfo pool_create_info{};
+            pool_create_info.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
+            pool_create_info.maxSets = 1000;
+            pool_create_info.poolSizeCount = std::size(pool_sizes);
+            pool_create_info.pPoolSizes = pool_sizes.data();
+
+            return device.createDescriptorPool(pool_create_info);
+        }
+
         inline void immediate_submit(vk::Device device, uint32_t queue_index, std::function<void(vk::CommandBuffer cmd)> func)
         {
             vk::FenceCreateInfo fence_create_info(vk::FenceCreateFlagBits::eSignaled);
@@ -423,6 +530,53 @@ namespace saf {
             return buffer;
         }
 
+        // Custom pool for buffers created like a sample_size buffer with these flags, memory comes in blocks of block_size
+        [[nodiscard]] inline vma::Pool CreateBufferPool(vk::DeviceSize sample_size, vk::BufferUsageFlags buffer_usage, vma::MemoryUsage memory_usage, vma::AllocationCreateFlags memory_flags, vk::DeviceSize block_size, vma::Allocator allocator)
+        {
+            const vk::BufferCreateInfo bufferInfo({}, sample_size, buffer_usage, vk::SharingMode::eExclusive);
+
+            vma::AllocationCreateInfo allocInfo = {};
+            allocInfo.usage = memory_usage;
+            allocInfo.flags = memory_flags;
+
+            uint32_t memory_type = 0;
+            if (allocator.findMemoryTypeIndexForBufferInfo(&bufferInfo, &allocInfo, &memory_type) != vk::Result::eSuccess)
+                IFX_ERROR("Failed to find a memory type for buffer pool");
+
+            vma::PoolCreateInfo poolInfo = {};
+            poolInfo.memoryTypeIndex = memory_type;
+            poolInfo.blockSize = block_size;
+
+            vma::Pool pool;
+            if (allocator.createPool(&poolInfo, &pool) != vk::Result::eSuccess)
+                IFX_ERROR("Failed to create buffer pool");
+
+            return pool;
+        }
+
+        // Persistently mapped buffer allocated from pool
+        [[nodiscard]] inline vk::Buffer CreateMappedBuffer(vk::DeviceSize size, vk::BufferUsageFlags buffer_usage, vma::Pool pool, vma::Allocator allocator, vma::Allocation& allocation, void*& mapped)
+        {
+            const vk::BufferCreateInfo bufferInfo({}, size, buffer_usage, vk::SharingMode::eExclusive);
+
+            vma::AllocationCreateInfo allocInfo = {};
+            allocInfo.usage = vma::MemoryUsage::eAutoPreferHost;
+            allocInfo.flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped;
+            allocInfo.pool = pool;
+
+            vk::Buffer buffer;
+            vma::AllocationInfo info;
+
+            if (allocator.createBuffer(&bufferInfo, &allocInfo, &buffer, &allocation, &info) != vk::Result::eSuccess)
+            {
+                mapped = nullptr;
+                return nullptr;
+            }
+
+            mapped = info.pMappedData;
+            return buffer;
+        }
+
         [[nodiscard]] inline vk::Image CreateImage(vk::Device device, uint32_t queue_index, vma::Allocator allocator, uint32_t width, uint32_t height, uint32_t depth, uint8_t* rawimagedata, vma::Allocation& image_allocation)
         {
             vk::ImageCreateInfo image_create_info(
@@ -506,90 +660,38 @@ namespace saf {
             return image;
         }
 
-        [[nodiscard]] inline vk::Image CreateImage3D(vk::Device device, uint32_t queue_index, vma::Allocator allocator, uint32_t width, uint32_t height, uint32_t layers, uint32_t depth, uint8_t* rawimagedata, vma::Allocation& image_allocation)
+        // 2D array image for sub rectangle updates, left in eUndefined layout
+        [[nodiscard]] inline vk::Image AllocateImage2DArray(vma::Allocator allocator, uint32_t width, uint32_t height, uint32_t layers, vk::Format format, vk::ImageUsageFlags usage, vma::Allocation& image_allocation)
         {
             vk::ImageCreateInfo image_create_info(
                 {},
-                vk::ImageType::e3D,
-                {},
-                vk::Extent3D(width, height, layers),
-                1,
+                vk::ImageType::e2D,
+                format,
+                vk::Extent3D(width, height, 1),
                 1,
+                layers,
                 vk::SampleCountFlagBits::e1,
                 vk::ImageTiling::eOptimal,
-                vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+                usage,
                 vk::SharingMode::eExclusive,
                 {},
                 {},
                 vk::ImageLayout::eUndefined
             );
 
-            switch (depth)
-            {
-            case 1: image_create_info.format = vk::Format::eR8Unorm; break;
-            case 2: image_create_info.format = vk::Format::eR8G8Unorm; break;
-            case 3: image_create_info.format = vk::Format::eR8G8B8Unorm; break;
-            case 4: image_create_info.format = vk::Format::eR8G8B8A8Unorm; break;
-            default: IFX_ERROR("Unsupported image depth"); break;
-            }
-
             vma::AllocationCreateInfo alloc_create_info{};
-            vk::Image image;
-
             alloc_create_info.flags = vma::AllocationCreateFlagBits::eDedicatedMemory;
             alloc_create_info.usage = vma::MemoryUsage::eGpuOnly;
 
+            vk::Image image;
             if (allocator.createImage(&image_create_info, &alloc_create_info, &image, &image_allocation, nullptr) != vk::Result::eSuccess)
                 IFX_ERROR("Failed to create image");
 
-            uint8_t* imagedata;
-
-            vma::Allocation staging_allocation;
-            vk::Buffer stageing_buffer = vkhelper::create_buffer(sizeof(uint8_t) * width * height * layers * depth, vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive, vma::MemoryUsage::eCpuToGpu, vma::AllocationCreateFlagBits::eHostAccessSequentialWrite, allocator, staging_allocation);
-
-            ERR_GUARD_VULKAN(vmaMapMemory(allocator, staging_allocation, reinterpret_cast<void**>(&imagedata)));
-            memcpy(imagedata, rawimagedata, sizeof(uint8_t) * width * height * layers * depth);
-            vmaUnmapMemory(allocator, staging_allocation);
-
-            vkhelper::immediate_submit(device, queue_index, [width, height, layers, stageing_buffer, image](vk::CommandBuffer cmd)
-                {
-                    vk::ImageMemoryBarrier image_memory_barrier_pre(
-                        vk::AccessFlagBits::eNone,
-                        vk::AccessFlagBits::eTransferWrite,
-                        vk::ImageLayout::eUndefined,
-                        vk::ImageLayout::eTransferDstOptimal,
-                        VK_QUEUE_FAMILY_IGNORED,
-                        VK_QUEUE_FAMILY_IGNORED,
-                        image,
-                        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-                    );
-
-                    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eHost, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, image_memory_barrier_pre);
-
-                    vk::BufferImageCopy buffer_image_copy(0, 0, 0, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1), vk::Offset3D(0, 0, 0), vk::Extent3D(width, height, layers));
-
-                    cmd.copyBufferToImage(stageing_buffer, image, vk::ImageLayout::eTransferDstOptimal, buffer_image_copy);
-
-                    vk::ImageMemoryBarrier image_memory_barrier_post(
-                        vk::AccessFlagBits::eTransferWrite,
-                        vk::AccessFlagBits::eShaderRead,
-                        vk::ImageLayout::eTransferDstOptimal,
-                        vk::ImageLayout::eShaderReadOnlyOptimal,
-                        VK_QUEUE_FAMILY_IGNORED,
-                        VK_QUEUE_FAMILY_IGNORED,
-                        image,
-                        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-                    );
-
-                    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, image_memory_barrier_post);
-                });
-
-            allocator.destroyBuffer(stageing_buffer, staging_allocation);
-
             return image;
         }
 
-        [[nodiscard]] inline vk::Sampler CreateFontSampler(vk::Device device)
+        // Distance field glyphs want linear minification too, coverage glyphs stay on nearest
+        [[nodiscard]] inline vk::Sampler CreateFontSampler(vk::Device device, vk::Filter min_filter = vk::Filter::eNearest)
         {
             vk::SamplerCreateInfo sampler_create_info{};
             sampler_create_info.addressModeU = vk::SamplerAddressMode::eRepeat;
@@ -604,7 +706,7 @@ namespace saf {
             sampler_create_info.compareEnable = vk::False;
             sampler_create_info.compareOp = vk::CompareOp::eAlways;
 
-            sampler_create_info.minFilter = vk::Filter::eNearest;
+            sampler_create_info.minFilter = min_filter;
             sampler_create_info.magFilter = vk::Filter::eLinear;
             sampler_create_info.anisotropyEnable = vk::True;
             sampler_create_info.maxAnisotropy = 1.f;
@@ -613,6 +715,21 @@ namespace saf {
 
             return device.createSampler(sampler_create_info);
         }
+
+        [[nodiscard]] inline vk::Sampler CreateImageSampler(vk::Device device)
+        {
+            vk::SamplerCreateInfo sampler_create_info{};
+            sampler_create_info.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+            sampler_create_info.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+            sampler_create_info.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+            sampler_create_info.minFilter = vk::Filter::eLinear;
+            sampler_create_info.magFilter = vk::Filter::eLinear;
+            sampler_create_info.mipmapMode = vk::SamplerMipmapMode::eNearest;
+            sampler_create_info.maxLod = 0;
+            sampler_create_info.borderColor = vk::BorderColor::eFloatTransparentBlack;
+
+            return device.createSampler(sampler_create_info);
+        }
 	}
 
 }
\ No newline at end of file
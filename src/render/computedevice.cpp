@@ -0,0 +1,80 @@
+#include "safpch.h"
+#include "computedevice.h"
+
+#include "globals.h"
+#include "platform/vulkangraphics.h"
+
+namespace saf {
+
+    ComputeDevice::~ComputeDevice()
+    {
+        Shutdown();
+    }
+
+    void ComputeDevice::Init()
+    {
+        IFX_INFO("ComputeDevice Init (headless)");
+
+        global::g_Layers = {
+#ifdef SAF_DEBUG
+            "VK_LAYER_KHRONOS_validation"
+#endif
+        };
+
+        global::g_Extensions = {
+            "VK_KHR_portability_enumeration",
+#ifdef SAF_DEBUG
+            "VK_EXT_debug_utils",
+#endif
+        };
+
+        global::g_Instance = vkhelper::CreateInstance(global::g_Extensions, global::g_Layers);
+#ifdef SAF_DEBUG
+        global::g_Messenger = vkhelper::CreateDebugMessenger(global::g_Instance);
+#endif
+
+        global::g_PhysicalDevice = vkhelper::SelectPhysicalDevice(global::g_Instance);
+        IFX_INFO("ComputeDevice using {0}", global::g_PhysicalDevice.getProperties().deviceName.data());
+
+        if ((global::g_ComputeQueueIndex = vkhelper::FindQueueFamily(global::g_Instance, global::g_PhysicalDevice, vk::QueueFlagBits::eCompute, nullptr)) == UINT32_MAX)
+        {
+            IFX_ERROR("ComputeDevice failed FindQueueFamily compute");
+        }
+        else IFX_TRACE("ComputeDevice FindQueueFamily compute found at index: {0}", global::g_ComputeQueueIndex);
+
+        global::g_Device = vkhelper::CreateLogicalDevice(global::g_Instance, global::g_PhysicalDevice, global::g_ComputeQueueIndex);
+        global::g_ComputeQueue = global::g_Device.getQueue(global::g_ComputeQueueIndex, 0);
+
+        global::g_Allocator = vkhelper::CreateAllocator(global::g_Instance, global::g_PhysicalDevice, global::g_Device);
+        global::g_DescriptorPool = vkhelper::CreateDescriptorPool(global::g_Device);
+
+        global::g_PipelineCache = std::make_shared<PipelineCache>();
+        global::g_PipelineCache->Init(global::g_PipelineCachePath);
+
+        m_Initialized = true;
+    }
+
+    void ComputeDevice::Shutdown()
+    {
+        if (!m_Initialized) return;
+        m_Initialized = false;
+
+        IFX_INFO("ComputeDevice Shutdown");
+
+        if (global::g_Device) global::g_Device.waitIdle();
+
+        global::g_PipelineCache.reset();
+        if (global::g_DescriptorPool) global::g_Device.destroyDescriptorPool(global::g_DescriptorPool);
+        if (global::g_Allocator) global::g_Allocator.destroy();
+        if (global::g_Device) global::g_Device.destroy();
+        if (global::g_Messenger) global::g_Instance.destroyDebugUtilsMessengerEXT(global::g_Messenger);
+        if (global::g_Instance) global::g_Instance.destroy();
+
+        global::g_DescriptorPool = nullptr;
+        global::g_Allocator = nullptr;
+        global::g_Device = nullptr;
+        global::g_Messenger = nullptr;
+        global::g_Instance = nullptr;
+    }
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+namespace saf {
+
+    /*
+    Headless Vulkan bring-up for effects, no GLFW, surface or swapchain:
+
+    - create instance (no window system extensions)
+    - select physical device (VK_ICD_FILENAMES / VK_DRIVER_FILES can point the loader at lavapipe)
+    - find a compute queue family, presentation is not required
+    - create logical device, allocator and descriptor pool into saf::global
+
+    Fills the same globals Window::InitVulkan does, so vkhelper and effect code run unchanged on either.
+    */
+    class ComputeDevice
+    {
+    public:
+        ComputeDevice() = default;
+        ComputeDevice(const ComputeDevice&) = delete;
+        ComputeDevice(ComputeDevice&&) = delete;
+        ComputeDevice& operator=(const ComputeDevice&) = delete;
+        ComputeDevice& operator=(ComputeDevice&&) = delete;
+        ~ComputeDevice();
+
+        void Init();
+        void Shutdown();
+
+    private:
+        bool m_Initialized = false;
+    };
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace saf {
+
+    namespace shaders {
+
+        // SPIR-V compiled from assets/shaders by glslc at build time, see embeddedshaders.cpp.in and CMakeLists.txt.
+        struct EmbeddedShader
+        {
+            const char* path;       // source path, e.g. "assets/shaders/quad.vert"
+            const uint32_t* code;
+            size_t size;            // in bytes
+        };
+
+        // nullptr if no shader was built from path
+        const EmbeddedShader* FindEmbeddedShader(const std::string& path);
+
+    }
+
+}
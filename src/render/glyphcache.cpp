@@ -0,0 +1,689 @@
+#include "safpch.h"
+#include "glyphcache.h"
+
+#include "platform/vulkangraphics.h"
+#include "globals.h"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "utils/hash.h"
+
+namespace saf {
+
+    // Empty border around every glyph so linear filtering never picks up a neighbour
+    static constexpr uint32_t s_GlyphPadding = 1;
+    // Shelves are opened in multiples of this height so glyphs of similar size share them
+    static constexpr uint32_t s_ShelfGranularity = 4;
+
+    // SDF glyphs are rasterized at this fraction of the layout height, with s_SdfPadding pixels of falloff around the outline.
+    // Texel values: 128 on the outline, dropping to 0 s_SdfPadding pixels outside of it.
+    static constexpr float s_SdfRasterFraction = 0.5f;
+    static constexpr int s_SdfPadding = 4;
+    static constexpr uint8_t s_SdfOnEdge = 128;
+    static constexpr float s_SdfDistanceScale = static_cast<float>(s_SdfOnEdge) / s_SdfPadding;
+
+    // Cache file: header, PageRecord[pages], Shelf[shelves], GlyphRecord[glyphs], R8 pixels[pages * s_PageSize * s_PageSize]
+    static constexpr uint32_t s_GlyphCacheMagic = 0x47464153; // "SAFG"
+    static constexpr uint32_t s_GlyphCacheVersion = 1;
+
+    struct GlyphCacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t pages;
+        uint32_t shelves;
+        uint32_t glyphs;
+        uint32_t padding;
+    };
+
+    struct PageRecord
+    {
+        uint32_t top;
+        uint32_t shelves;
+    };
+
+    struct GlyphRecord
+    {
+        uint64_t key;
+        Glyph glyph;
+    };
+
+    static inline uint64_t GlyphKey(uint32_t font, char32_t code)
+    {
+        return (static_cast<uint64_t>(font) << 32) | static_cast<uint64_t>(code);
+    }
+
+    GlyphCache::GlyphCache(std::vector<std::string> files, float pixel_height, GlyphMode mode, std::string cache_path)
+        : m_Files(std::move(files)), m_PixelHeight(pixel_height), m_Mode(mode), m_CachePath(std::move(cache_path))
+    {
+        m_RasterHeight = m_Mode == GlyphMode::SDF ? std::round(m_PixelHeight * s_SdfRasterFraction) : m_PixelHeight;
+        m_MetricScale = m_PixelHeight / m_RasterHeight;
+
+        m_Faces.resize(m_Files.size());
+
+        if (!m_CachePath.empty())
+        {
+            m_CacheKey = CacheKey();
+            if (LoadCache()) return;
+        }
+        Grow(1);
+    }
+
+    GlyphCache::~GlyphCache()
+    {
+    }
+
+    void GlyphCache::Shutdown()
+    {
+        // Called with the device idle, a grow no frame has recorded yet is finished here so the pages can be saved
+        if (m_Retired.image)
+        {
+            vkhelper::immediate_submit(global::g_Device, global::g_GraphicsQueueIndex, [this](vk::CommandBuffer cmd) { RecordGrow(cmd); });
+            global::g_Device.destroyImageView(m_Retired.view);
+            global::g_Allocator.destroyImage(m_Retired.image, m_Retired.allocation);
+            m_Retired = {};
+        }
+
+        if (m_vkPages && m_CacheDirty && !m_CachePath.empty()) SaveCache();
+        m_CacheDirty = false;
+
+        for (StagingBuffer& staging : m_Staging)
+        {
+            if (!staging.buffer) continue;
+            global::g_Allocator.unmapMemory(staging.allocation);
+            global::g_Allocator.destroyBuffer(staging.buffer, staging.allocation);
+        }
+        m_Staging.clear();
+
+        if (m_vkPagesView) global::g_Device.destroyImageView(m_vkPagesView);
+        if (m_vkPages) global::g_Allocator.destroyImage(m_vkPages, m_vmaPagesAllocation);
+        m_vkPagesView = nullptr;
+        m_vkPages = nullptr;
+    }
+
+    GlyphCache::Face* GlyphCache::GetFace(uint32_t font)
+    {
+        if (font >= m_Faces.size()) return nullptr;
+        if (!m_Faces[font]) m_Faces[font] = std::make_unique<Face>();
+
+        Face* face = m_Faces[font].get();
+        if (!face->loaded)
+        {
+            face->loaded = true;
+            if (!face->file.Open(m_Files[font]))
+            {
+                IFX_WARN("GlyphCache could not open {0}", m_Files[font]);
+            }
+            else if (!stbtt_InitFont(&face->info, face->file.GetData(), stbtt_GetFontOffsetForIndex(face->file.GetData(), 0)))
+            {
+                IFX_WARN("GlyphCache could not parse {0}", m_Files[font]);
+                face->file.Close();
+            }
+            else
+            {
+                face->scale = stbtt_ScaleForPixelHeight(&face->info, m_RasterHeight);
+                face->valid = true;
+            }
+        }
+
+        return face->valid ? face : nullptr;
+    }
+
+    const Glyph* GlyphCache::Get(uint32_t font, char32_t code)
+    {
+        const uint64_t key = GlyphKey(font, code);
+
+        auto found = m_Glyphs.find(key);
+        if (found != m_Glyphs.end())
+        {
+            if (found->second.HasBitmap()) m_Pages[found->second.page].last_used = m_Frame;
+            return &found->second;
+        }
+
+        RasterGlyph raster;
+        Resolve(font, code, raster);
+        if (raster.face) Rasterize(raster);
+        return Place(key, raster);
+    }
+
+    void GlyphCache::Prefetch(const std::vector<std::pair<uint32_t, char32_t>>& glyphs)
+    {
+        // Faces are parsed and fallbacks looked up here, so the jobs below only ever read them
+        std::vector<uint64_t> keys;
+        std::vector<RasterGlyph> rasters;
+        for (const auto& [font, code] : glyphs)
+        {
+            const uint64_t key = GlyphKey(font, code);
+            if (m_Glyphs.count(key) || std::find(keys.begin(), keys.end(), key) != keys.end()) continue;
+
+            keys.push_back(key);
+            Resolve(font, code, rasters.emplace_back());
+        }
+        if (keys.empty()) return;
+
+        global::g_JobSystem->ParallelFor(static_cast<uint32_t>(rasters.size()), 0, [this, &rasters](uint32_t index)
+            {
+                if (rasters[index].face) Rasterize(rasters[index]);
+            });
+
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            if (!Place(keys[i], rasters[i])) break;
+        }
+    }
+
+    // Requested font first, then every other font, then the requested font's missing glyph
+    void GlyphCache::Resolve(uint32_t font, char32_t code, RasterGlyph& raster)
+    {
+        raster.code = code;
+        raster.face = GetFace(font);
+        raster.index = raster.face ? stbtt_FindGlyphIndex(&raster.face->info, static_cast<int>(code)) : 0;
+        for (uint32_t fallback = 0; raster.index == 0 && fallback < m_Faces.size(); ++fallback)
+        {
+            if (fallback == font) continue;
+            Face* other = GetFace(fallback);
+            if (!other) continue;
+            const int other_index = stbtt_FindGlyphIndex(&other->info, static_cast<int>(code));
+            if (other_index != 0)
+            {
+                raster.face = other;
+                raster.index = other_index;
+            }
+        }
+    }
+
+    // Metrics and pixels of one glyph, touches nothing but raster so Prefetch runs it on several threads at once
+    void GlyphCache::Rasterize(RasterGlyph& raster) const
+    {
+        const Face& face = *raster.face;
+
+        int advance = 0, bearing = 0;
+        stbtt_GetGlyphHMetrics(&face.info, raster.index, &advance, &bearing);
+        raster.glyph.xadvance = advance * face.scale * m_MetricScale;
+
+        int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+        unsigned char* sdf = nullptr;
+        if (m_Mode == GlyphMode::SDF)
+        {
+            // The SDF box includes the falloff
+            int sdf_width = 0, sdf_height = 0;
+            sdf = stbtt_GetGlyphSDF(&face.info, face.scale, raster.index, s_SdfPadding, s_SdfOnEdge, s_SdfDistanceScale, &sdf_width, &sdf_height, &x0, &y0);
+            x1 = sdf ? x0 + sdf_width : x0;
+            y1 = sdf ? y0 + sdf_height : y0;
+        }
+        else
+        {
+            stbtt_GetGlyphBitmapBox(&face.info, raster.index, face.scale, face.scale, &x0, &y0, &x1, &y1);
+        }
+        raster.width = static_cast<uint32_t>(std::max(0, x1 - x0));
+        raster.height = static_cast<uint32_t>(std::max(0, y1 - y0));
+
+        raster.glyph.xoff = x0 * m_MetricScale;
+        raster.glyph.yoff = y0 * m_MetricScale;
+        raster.glyph.width = raster.width * m_MetricScale;
+        raster.glyph.height = raster.height * m_MetricScale;
+
+        if (raster.width > 0 && raster.height > 0)
+        {
+            raster.pixels.resize(static_cast<size_t>(raster.width) * raster.height);
+            if (sdf) std::memcpy(raster.pixels.data(), sdf, raster.pixels.size());
+            else stbtt_MakeGlyphBitmap(&face.info, raster.pixels.data(), raster.width, raster.height, raster.width, face.scale, face.scale, raster.index);
+        }
+        if (sdf) stbtt_FreeSDF(sdf, nullptr);
+    }
+
+    // Finds room for a rasterized glyph and queues its upload, nullptr when the cache is out of room this frame
+    const Glyph* GlyphCache::Place(uint64_t key, const RasterGlyph& raster)
+    {
+        m_CacheDirty = true;
+
+        Glyph glyph = raster.glyph;
+        if (raster.pixels.empty()) return &(m_Glyphs[key] = glyph);
+
+        const uint32_t padded_width = raster.width + 2 * s_GlyphPadding;
+        const uint32_t padded_height = raster.height + 2 * s_GlyphPadding;
+
+        // Kept without a bitmap so it advances the pen but is not rasterized again every frame
+        if (padded_width > s_PageSize || padded_height > s_PageSize)
+        {
+            IFX_WARN("GlyphCache page is too small for U+{0:04X} ({1}x{2})", static_cast<uint32_t>(raster.code), padded_width, padded_height);
+            return &(m_Glyphs[key] = glyph);
+        }
+
+        uint32_t page = 0, x = 0, y = 0;
+        if (!Allocate(padded_width, padded_height, page, x, y))
+        {
+            IFX_WARN("GlyphCache is full, dropping U+{0:04X}", static_cast<uint32_t>(raster.code));
+            return nullptr;
+        }
+
+        // The whole padded rectangle is uploaded, which also clears whatever an evicted glyph left there
+        const size_t offset = m_PendingPixels.size();
+        m_PendingPixels.resize(offset + static_cast<size_t>(padded_width) * padded_height, 0);
+        uint8_t* pixels = m_PendingPixels.data() + offset + s_GlyphPadding * padded_width + s_GlyphPadding;
+        for (uint32_t row = 0; row < raster.height; ++row) std::memcpy(pixels + row * padded_width, raster.pixels.data() + row * raster.width, raster.width);
+
+        m_PendingCopies.push_back({ offset, page, x, y, padded_width, padded_height });
+
+        const float size = static_cast<float>(s_PageSize);
+        glyph.s0 = (x + s_GlyphPadding) / size;
+        glyph.t0 = (y + s_GlyphPadding) / size;
+        glyph.s1 = (x + s_GlyphPadding + raster.width) / size;
+        glyph.t1 = (y + s_GlyphPadding + raster.height) / size;
+        glyph.page = page;
+
+        m_Pages[page].glyphs.push_back(key);
+        m_Pages[page].last_used = m_Frame;
+
+        return &(m_Glyphs[key] = glyph);
+    }
+
+    bool GlyphCache::AllocateOnPage(Page& page, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y)
+    {
+        // Tightest existing shelf, without wasting more than a quarter of its height
+        Shelf* best = nullptr;
+        for (Shelf& shelf : page.shelves)
+        {
+            if (shelf.height < height || shelf.height > height + height / 4 + s_ShelfGranularity) continue;
+            if (shelf.x + width > s_PageSize) continue;
+            if (!best || shelf.height < best->height) best = &shelf;
+        }
+
+        if (!best)
+        {
+            const uint32_t shelf_height = std::min(s_PageSize, (height + s_ShelfGranularity - 1) / s_ShelfGranularity * s_ShelfGranularity);
+            if (page.top + shelf_height > s_PageSize || width > s_PageSize) return false;
+
+            page.shelves.push_back({ 0, page.top, shelf_height });
+            page.top += shelf_height;
+            best = &page.shelves.back();
+        }
+
+        x = best->x;
+        y = best->y;
+        best->x += width;
+        return true;
+    }
+
+    bool GlyphCache::Allocate(uint32_t width, uint32_t height, uint32_t& page, uint32_t& x, uint32_t& y)
+    {
+        // Checked first, growing or evicting for a rectangle no page can hold would only throw glyphs away
+        if (width > s_PageSize || height > s_PageSize) return false;
+
+        for (uint32_t p = 0; p < m_Pages.size(); ++p)
+        {
+            if (AllocateOnPage(m_Pages[p], width, height, x, y))
+            {
+                page = p;
+                return true;
+            }
+        }
+
+        if (m_Pages.size() < s_MaxPages)
+        {
+            if (m_Pages.size() == m_Layers) Grow(std::min(m_Layers * 2, s_MaxPages));
+            m_Pages.emplace_back();
+            page = static_cast<uint32_t>(m_Pages.size() - 1);
+            return AllocateOnPage(m_Pages[page], width, height, x, y);
+        }
+
+        // Least recently used page the current frame does not draw from
+        uint32_t victim = UINT32_MAX;
+        for (uint32_t p = 0; p < m_Pages.size(); ++p)
+        {
+            if (m_Pages[p].last_used == m_Frame) continue;
+            if (victim == UINT32_MAX || m_Pages[p].last_used < m_Pages[victim].last_used) victim = p;
+        }
+        if (victim == UINT32_MAX) return false;
+
+        Evict(victim);
+        page = victim;
+        return AllocateOnPage(m_Pages[page], width, height, x, y);
+    }
+
+    void GlyphCache::Touch(uint32_t pages)
+    {
+        for (uint32_t page = 0; page < m_Pages.size(); ++page)
+        {
+            if (pages & (1U << page)) m_Pages[page].last_used = m_Frame;
+        }
+    }
+
+    void GlyphCache::Evict(uint32_t page)
+    {
+        ++m_Epoch;
+        m_CacheDirty = true;
+        IFX_TRACE("GlyphCache evicting page {0} ({1} glyphs)", page, m_Pages[page].glyphs.size());
+        for (uint64_t key : m_Pages[page].glyphs) m_Glyphs.erase(key);
+        m_Pages[page] = Page{};
+    }
+
+    // Hash of every font file plus everything that changes what gets rasterized or where, any change invalidates the cache
+    uint64_t GlyphCache::CacheKey() const
+    {
+        uint32_t pixel_height;
+        std::memcpy(&pixel_height, &m_PixelHeight, sizeof(pixel_height));
+        const uint32_t parameters[] = {
+            s_PageSize, pixel_height, static_cast<uint32_t>(m_Mode), s_GlyphPadding, s_ShelfGranularity,
+            static_cast<uint32_t>(s_SdfPadding), s_SdfOnEdge, static_cast<uint32_t>(sizeof(Glyph))
+        };
+        uint64_t key = Fnv1a64(parameters, sizeof(parameters));
+
+        for (const std::string& file : m_Files)
+        {
+            MappedFile font;
+            if (font.Open(file)) key = Fnv1a64(font.GetData(), font.GetSize(), key);
+            key = Fnv1a64(file.data(), file.size(), key);
+        }
+
+        return key;
+    }
+
+    bool GlyphCache::LoadCache()
+    {
+        MappedFile cache;
+        if (!cache.Open(m_CachePath)) return false;
+
+        GlyphCacheHeader header{};
+        if (cache.GetSize() < sizeof(header)) return false;
+        std::memcpy(&header, cache.GetData(), sizeof(header));
+        if (header.magic != s_GlyphCacheMagic || header.version != s_GlyphCacheVersion || header.key != m_CacheKey ||
+            header.pages == 0 || header.pages > s_MaxPages)
+        {
+            IFX_INFO("GlyphCache {0} is stale, rasterizing from scratch", m_CachePath);
+            return false;
+        }
+
+        const size_t page_bytes = static_cast<size_t>(s_PageSize) * s_PageSize;
+        const size_t pages_offset = sizeof(header);
+        const size_t shelves_offset = pages_offset + header.pages * sizeof(PageRecord);
+        const size_t glyphs_offset = shelves_offset + static_cast<size_t>(header.shelves) * sizeof(Shelf);
+        const size_t pixels_offset = glyphs_offset + static_cast<size_t>(header.glyphs) * sizeof(GlyphRecord);
+        if (cache.GetSize() != pixels_offset + header.pages * page_bytes)
+        {
+            IFX_WARN("GlyphCache {0} is truncated or corrupt, rasterizing from scratch", m_CachePath);
+            return false;
+        }
+
+        std::vector<PageRecord> records(header.pages);
+        std::vector<Shelf> shelves(header.shelves);
+        std::vector<GlyphRecord> glyphs(header.glyphs);
+        std::memcpy(records.data(), cache.GetData() + pages_offset, records.size() * sizeof(PageRecord));
+        std::memcpy(shelves.data(), cache.GetData() + shelves_offset, shelves.size() * sizeof(Shelf));
+        std::memcpy(glyphs.data(), cache.GetData() + glyphs_offset, glyphs.size() * sizeof(GlyphRecord));
+
+        std::vector<Page> pages(header.pages);
+        size_t shelf = 0;
+        for (uint32_t p = 0; p < header.pages; ++p)
+        {
+            if (records[p].shelves > shelves.size() - shelf || records[p].top > s_PageSize) return false;
+            pages[p].shelves.assign(shelves.begin() + shelf, shelves.begin() + shelf + records[p].shelves);
+            pages[p].top = records[p].top;
+            shelf += records[p].shelves;
+        }
+
+        std::unordered_map<uint64_t, Glyph> table;
+        table.reserve(glyphs.size());
+        for (const GlyphRecord& record : glyphs)
+        {
+            if (record.glyph.HasBitmap())
+            {
+                if (record.glyph.page >= header.pages) return false;
+                pages[record.glyph.page].glyphs.push_back(record.key);
+            }
+            table.emplace(record.key, record.glyph);
+        }
+
+        uint32_t layers = 1;
+        while (layers < header.pages) layers *= 2;
+        Grow(layers);
+
+        m_Pages = std::move(pages);
+        m_Glyphs = std::move(table);
+
+        // Straight from the mapping into the staging buffer
+        UploadPages(cache.GetData() + pixels_offset, header.pages);
+
+        IFX_INFO("GlyphCache loaded {0} glyphs on {1} pages from {2}", m_Glyphs.size(), m_Pages.size(), m_CachePath);
+        return true;
+    }
+
+    // Reads the pages back (the device is idle at Shutdown), adds glyphs still waiting for Upload and writes the cache file
+    void GlyphCache::SaveCache()
+    {
+        const uint32_t page_count = static_cast<uint32_t>(m_Pages.size());
+        const size_t page_bytes = static_cast<size_t>(s_PageSize) * s_PageSize;
+        std::vector<uint8_t> pixels(page_count * page_bytes);
+
+        vma::Allocation allocation;
+        vk::Buffer buffer = vkhelper::create_buffer(static_cast<uint32_t>(pixels.size()), vk::BufferUsageFlagBits::eTransferDst, vk::SharingMode::eExclusive, vma::MemoryUsage::eAutoPreferHost, vma::AllocationCreateFlagBits::eHostAccessRandom, global::g_Allocator, allocation);
+
+        vk::Image image = m_vkPages;
+        vkhelper::immediate_submit(global::g_Device, global::g_GraphicsQueueIndex, [image, buffer, page_count](vk::CommandBuffer cmd)
+            {
+                const vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, page_count);
+                vk::ImageMemoryBarrier barrier_pre(vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferRead, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal,
+                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, range);
+                cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier_pre);
+
+                vk::BufferImageCopy region(0, 0, 0, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, page_count), vk::Offset3D(0, 0, 0), vk::Extent3D(s_PageSize, s_PageSize, 1));
+                cmd.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, buffer, region);
+
+                vk::ImageMemoryBarrier barrier_post(vk::AccessFlagBits::eTransferRead, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, range);
+                vk::BufferMemoryBarrier barrier_host(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, buffer, 0, VK_WHOLE_SIZE);
+                cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eHost, {}, {}, barrier_host, barrier_post);
+            });
+
+        uint8_t* mapped;
+        if (global::g_Allocator.mapMemory(allocation, reinterpret_cast<void**>(&mapped)) != vk::Result::eSuccess)
+            IFX_ERROR("Failed to map glyph readback buffer");
+        (void)global::g_Allocator.invalidateAllocation(allocation, 0, VK_WHOLE_SIZE);
+        std::memcpy(pixels.data(), mapped, pixels.size());
+        global::g_Allocator.unmapMemory(allocation);
+        global::g_Allocator.destroyBuffer(buffer, allocation);
+
+        for (const PendingCopy& copy : m_PendingCopies)
+        {
+            uint8_t* destination = pixels.data() + copy.page * page_bytes + static_cast<size_t>(copy.y) * s_PageSize + copy.x;
+            for (uint32_t row = 0; row < copy.height; ++row)
+                std::memcpy(destination + static_cast<size_t>(row) * s_PageSize, m_PendingPixels.data() + copy.offset + static_cast<size_t>(row) * copy.width, copy.width);
+        }
+
+        std::vector<PageRecord> records;
+        std::vector<Shelf> shelves;
+        for (const Page& page : m_Pages)
+        {
+            records.push_back({ page.top, static_cast<uint32_t>(page.shelves.size()) });
+            shelves.insert(shelves.end(), page.shelves.begin(), page.shelves.end());
+        }
+
+        std::vector<GlyphRecord> glyphs;
+        glyphs.reserve(m_Glyphs.size());
+        for (const auto& [key, glyph] : m_Glyphs) glyphs.push_back({ key, glyph });
+
+        const GlyphCacheHeader header{ s_GlyphCacheMagic, s_GlyphCacheVersion, m_CacheKey, page_count, static_cast<uint32_t>(shelves.size()), static_cast<uint32_t>(glyphs.size()), 0 };
+
+        std::error_code error;
+        const std::filesystem::path target(m_CachePath);
+        if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path(), error);
+
+        // Write next to the target and rename over it, a crash mid write never leaves a half written cache behind
+        const std::string temp = m_CachePath + ".tmp";
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(PageRecord)));
+            file.write(reinterpret_cast<const char*>(shelves.data()), static_cast<std::streamsize>(shelves.size() * sizeof(Shelf)));
+            file.write(reinterpret_cast<const char*>(glyphs.data()), static_cast<std::streamsize>(glyphs.size() * sizeof(GlyphRecord)));
+            file.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+            if (!file)
+            {
+                IFX_WARN("GlyphCache failed to write {0}", temp);
+                return;
+            }
+        }
+
+        std::filesystem::rename(temp, m_CachePath, error);
+        if (error) IFX_WARN("GlyphCache failed to replace {0}: {1}", m_CachePath, error.message());
+        else IFX_INFO("GlyphCache saved {0} glyphs on {1} pages to {2}", glyphs.size(), page_count, m_CachePath);
+    }
+
+    // Fills the first pages layers of the page image from pixels, used once at startup before any frame samples it
+    void GlyphCache::UploadPages(const uint8_t* pixels, uint32_t pages)
+    {
+        const size_t size = static_cast<size_t>(s_PageSize) * s_PageSize * pages;
+
+        vma::Allocation allocation;
+        vk::Buffer buffer = vkhelper::create_buffer(static_cast<uint32_t>(size), vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive, vma::MemoryUsage::eAutoPreferHost, vma::AllocationCreateFlagBits::eHostAccessSequentialWrite, global::g_Allocator, allocation);
+
+        uint8_t* mapped;
+        if (global::g_Allocator.mapMemory(allocation, reinterpret_cast<void**>(&mapped)) != vk::Result::eSuccess)
+            IFX_ERROR("Failed to map glyph staging buffer");
+        std::memcpy(mapped, pixels, size);
+        (void)global::g_Allocator.flushAllocation(allocation, 0, VK_WHOLE_SIZE);
+        global::g_Allocator.unmapMemory(allocation);
+
+        vk::Image image = m_vkPages;
+        vkhelper::immediate_submit(global::g_Device, global::g_GraphicsQueueIndex, [image, buffer, pages](vk::CommandBuffer cmd)
+            {
+                const vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, pages);
+                vk::ImageMemoryBarrier barrier_pre(vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferDstOptimal,
+                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, range);
+                cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier_pre);
+
+                vk::BufferImageCopy region(0, 0, 0, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, pages), vk::Offset3D(0, 0, 0), vk::Extent3D(s_PageSize, s_PageSize, 1));
+                cmd.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, region);
+
+                vk::ImageMemoryBarrier barrier_post(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, range);
+                cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier_post);
+            });
+
+        global::g_Allocator.destroyBuffer(buffer, allocation);
+    }
+
+    // Replaces the page image with one of layers layers and copies the existing pages over.
+    // Waits for the device, callers must not be recording a frame.
+    void GlyphCache::Grow(uint32_t layers)
+    {
+        // Growing twice before an Upload(): the image in between was never recorded into, only the retired one holds pages
+        if (m_Retired.image)
+        {
+            global::g_Device.destroyImageView(m_vkPagesView);
+            global::g_Allocator.destroyImage(m_vkPages, m_vmaPagesAllocation);
+        }
+        else
+        {
+            m_Retired = { m_vkPages, m_vmaPagesAllocation, m_vkPagesView, m_Layers };
+        }
+
+        m_vkPages = vkhelper::AllocateImage2DArray(global::g_Allocator, s_PageSize, s_PageSize, layers, vk::Format::eR8Unorm,
+            vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc, m_vmaPagesAllocation);
+        m_Layers = layers;
+
+        vk::ImageViewCreateInfo imageview_create_info({}, m_vkPages, vk::ImageViewType::e2DArray, vk::Format::eR8Unorm, {}, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, m_Layers));
+        m_vkPagesView = global::g_Device.createImageView(imageview_create_info);
+
+        // The first image has nothing to copy, nothing renders yet and it is made readable right away
+        if (!m_Retired.image) vkhelper::immediate_submit(global::g_Device, global::g_GraphicsQueueIndex, [this](vk::CommandBuffer cmd) { RecordGrow(cmd); });
+
+        IFX_TRACE("GlyphCache grown to {0} pages", m_Layers);
+    }
+
+    // Copies the retired image's pages into the current image and leaves the current image shader readable
+    void GlyphCache::RecordGrow(vk::CommandBuffer cmd)
+    {
+        std::vector<vk::ImageMemoryBarrier> barriers_pre
+        {
+            vk::ImageMemoryBarrier(vk::AccessFlagBits::eNone, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, m_vkPages, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, m_Layers))
+        };
+        if (m_Retired.image)
+        {
+            // Earlier submits on the queue may still sample the retired image, the barrier orders the copy after them
+            barriers_pre.emplace_back(vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferRead, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, m_Retired.image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, m_Retired.layers));
+        }
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barriers_pre);
+
+        if (m_Retired.image)
+        {
+            vk::ImageCopy copy(
+                vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, m_Retired.layers), vk::Offset3D(0, 0, 0),
+                vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, m_Retired.layers), vk::Offset3D(0, 0, 0),
+                vk::Extent3D(s_PageSize, s_PageSize, 1));
+            cmd.copyImage(m_Retired.image, vk::ImageLayout::eTransferSrcOptimal, m_vkPages, vk::ImageLayout::eTransferDstOptimal, copy);
+        }
+
+        vk::ImageMemoryBarrier barrier_post(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, m_vkPages, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, m_Layers));
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier_post);
+    }
+
+    void GlyphCache::Upload(vk::CommandBuffer cmd, uint32_t frame, const DeferFn& defer)
+    {
+        ++m_Frame;
+
+        if (m_Retired.image)
+        {
+            RecordGrow(cmd);
+            defer([retired = m_Retired]()
+                {
+                    global::g_Device.destroyImageView(retired.view);
+                    global::g_Allocator.destroyImage(retired.image, retired.allocation);
+                });
+            m_Retired = {};
+        }
+
+        if (m_PendingCopies.empty()) return;
+
+        if (frame >= m_Staging.size()) m_Staging.resize(frame + 1);
+        StagingBuffer& staging = m_Staging[frame];
+
+        // The frame's fence has been waited on, so its staging buffer is free to overwrite or replace
+        if (staging.capacity < m_PendingPixels.size())
+        {
+            if (staging.buffer)
+            {
+                global::g_Allocator.unmapMemory(staging.allocation);
+                global::g_Allocator.destroyBuffer(staging.buffer, staging.allocation);
+            }
+
+            staging.capacity = std::max<size_t>(m_PendingPixels.size(), static_cast<size_t>(s_PageSize) * 64);
+            staging.buffer = vkhelper::create_buffer(static_cast<uint32_t>(staging.capacity), vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive, vma::MemoryUsage::eAutoPreferHost, vma::AllocationCreateFlagBits::eHostAccessSequentialWrite, global::g_Allocator, staging.allocation);
+            if (global::g_Allocator.mapMemory(staging.allocation, reinterpret_cast<void**>(&staging.data)) != vk::Result::eSuccess)
+                IFX_ERROR("Failed to map glyph staging buffer");
+        }
+
+        std::memcpy(staging.data, m_PendingPixels.data(), m_PendingPixels.size());
+
+        std::vector<vk::BufferImageCopy> regions;
+        regions.reserve(m_PendingCopies.size());
+        for (const PendingCopy& copy : m_PendingCopies)
+        {
+            regions.emplace_back(copy.offset, copy.width, copy.height, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, copy.page, 1),
+                vk::Offset3D(copy.x, copy.y, 0), vk::Extent3D(copy.width, copy.height, 1));
+        }
+
+        const vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, m_Layers);
+
+        vk::ImageMemoryBarrier barrier_pre(vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferDstOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, m_vkPages, range);
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier_pre);
+
+        cmd.copyBufferToImage(staging.buffer, m_vkPages, vk::ImageLayout::eTransferDstOptimal, regions);
+
+        vk::ImageMemoryBarrier barrier_post(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, m_vkPages, range);
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier_post);
+
+        m_PendingPixels.clear();
+        m_PendingCopies.clear();
+    }
+
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <vk_mem_alloc.hpp>
+#include <vulkan/vulkan.hpp>
+#include <stb_truetype.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "utils/mappedfile.h"
+
+namespace saf {
+
+    enum class GlyphMode
+    {
+        Bitmap, // coverage at the layout size, sharp at scale 1, blurs when scaled up
+        SDF     // signed distance at half the layout size, sampled with fonts_sdf.frag and crisp at any scale
+    };
+
+    // One rasterized glyph, metrics in pixels at the cache's layout height (y down, relative to the pen position)
+    struct Glyph
+    {
+        static constexpr uint32_t s_NoPage = UINT32_MAX;
+
+        float s0 = 0.f, t0 = 0.f, s1 = 0.f, t1 = 0.f;
+        float xoff = 0.f, yoff = 0.f;
+        float width = 0.f, height = 0.f;
+        float xadvance = 0.f;
+        uint32_t page = s_NoPage;
+
+        inline bool HasBitmap() const { return page != s_NoPage; }
+    };
+
+    /*
+    Glyphs rasterized on first use into R8 pages, the layers of one 2D array image.
+
+    - pages are shelf packed, a glyph goes on the tightest shelf of similar height with room left
+    - with every page full, the least recently used page that the current frame has not touched is evicted
+    - the image starts with one layer and doubles up to s_MaxPages, memory follows the glyphs actually drawn
+    - growing never waits for the GPU, the old pages are copied in the next frame's commands and the old image is deferred
+    - new glyphs are queued on the CPU, Upload() copies only their rectangles into the image
+    - Prefetch() rasterizes a whole string's misses on the job system before its layout asks for them one by one
+    - code points a font lacks come from the next font that has them, else the font's missing glyph
+
+    Fonts are memory mapped and parsed on first use.
+    Metrics are always reported at pixel_height, in SDF mode the pages just hold smaller distance fields.
+
+    With a cache_path the pages and glyph table are written there on Shutdown and mapped back in by the next run,
+    keyed by a hash of the font files, pixel_height and mode, so a warm start draws without rasterizing anything.
+    */
+    class GlyphCache
+    {
+    public:
+        static constexpr uint32_t s_PageSize = 1024;
+        static constexpr uint32_t s_MaxPages = 16; // page masks are 32 bit
+
+        GlyphCache(std::vector<std::string> files, float pixel_height, GlyphMode mode = GlyphMode::Bitmap, std::string cache_path = {});
+        GlyphCache(const GlyphCache&) = delete;
+        GlyphCache(GlyphCache&&) = delete;
+        GlyphCache& operator=(const GlyphCache&) = delete;
+        GlyphCache& operator=(GlyphCache&&) = delete;
+        ~GlyphCache();
+
+        void Shutdown();
+
+        // nullptr when the glyph does not fit because every page is in use by the current frame
+        const Glyph* Get(uint32_t font, char32_t code);
+
+        // Rasterizes the (font, code) pairs not cached yet on global::g_JobSystem and places them, so the Get() calls that follow hit
+        void Prefetch(const std::vector<std::pair<uint32_t, char32_t>>& glyphs);
+
+        // Takes work that may only run once the submit being recorded has completed
+        using DeferFn = std::function<void(std::function<void()>)>;
+
+        // Records the copies for every glyph rasterized since the last call, outside of rendering.
+        // frame selects the staging buffer, it must not be reused before the GPU is done with that frame.
+        // An image replaced by growing is copied from in cmd and handed to defer for destruction.
+        void Upload(vk::CommandBuffer cmd, uint32_t frame, const DeferFn& defer);
+
+        inline vk::ImageView GetImageView() const { return m_vkPagesView; }
+        inline float GetPixelHeight() const { return m_PixelHeight; }
+        inline GlyphMode GetMode() const { return m_Mode; }
+        inline uint32_t GetPageCount() const { return static_cast<uint32_t>(m_Pages.size()); }
+
+        // Changes whenever a page is evicted, anything holding on to glyph placements must be rebuilt
+        inline uint64_t GetEpoch() const { return m_Epoch; }
+
+        // Marks pages (bit per page) as used this frame, for glyphs drawn without going through Get()
+        void Touch(uint32_t pages);
+
+    private:
+        struct Face
+        {
+            MappedFile file;
+            stbtt_fontinfo info{};
+            float scale = 0.f;
+            bool loaded = false;
+            bool valid = false;
+        };
+
+        // A glyph between lookup and placement, pixels are width * height without padding
+        struct RasterGlyph
+        {
+            const Face* face = nullptr;
+            int index = 0;
+            char32_t code = 0;
+            Glyph glyph{};
+            uint32_t width = 0, height = 0;
+            std::vector<uint8_t> pixels;
+        };
+
+        struct Shelf
+        {
+            uint32_t x, y, height;
+        };
+
+        struct Page
+        {
+            std::vector<Shelf> shelves;
+            uint32_t top = 0;
+            uint64_t last_used = 0;
+            std::vector<uint64_t> glyphs;
+        };
+
+        struct PendingCopy
+        {
+            size_t offset;
+            uint32_t page, x, y, width, height;
+        };
+
+        // The image before the last Grow(), its pages are copied over by the next Upload()
+        struct RetiredImage
+        {
+            vk::Image image = nullptr;
+            vma::Allocation allocation = nullptr;
+            vk::ImageView view = nullptr;
+            uint32_t layers = 0;
+        };
+
+        struct StagingBuffer
+        {
+            vk::Buffer buffer = nullptr;
+            vma::Allocation allocation = nullptr;
+            uint8_t* data = nullptr;
+            size_t capacity = 0;
+        };
+
+        Face* GetFace(uint32_t font);
+        void Resolve(uint32_t font, char32_t code, RasterGlyph& raster);
+        void Rasterize(RasterGlyph& raster) const;
+        const Glyph* Place(uint64_t key, const RasterGlyph& raster);
+        uint64_t CacheKey() const;
+        bool LoadCache();
+        void SaveCache();
+        void UploadPages(const uint8_t* pixels, uint32_t pages);
+        bool Allocate(uint32_t width, uint32_t height, uint32_t& page, uint32_t& x, uint32_t& y);
+        bool AllocateOnPage(Page& page, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+        void Evict(uint32_t page);
+        void Grow(uint32_t layers);
+        void RecordGrow(vk::CommandBuffer cmd);
+
+        std::vector<std::string> m_Files;
+        std::vector<std::unique_ptr<Face>> m_Faces;
+        const float m_PixelHeight;
+        const GlyphMode m_Mode;
+        float m_RasterHeight;
+        float m_MetricScale;
+
+        std::string m_CachePath;
+        uint64_t m_CacheKey = 0;
+        bool m_CacheDirty = false;
+
+        std::unordered_map<uint64_t, Glyph> m_Glyphs;
+        std::vector<Page> m_Pages;
+        uint64_t m_Frame = 1;
+        uint64_t m_Epoch = 0;
+
+        std::vector<uint8_t> m_PendingPixels;
+        std::vector<PendingCopy> m_PendingCopies;
+        std::vector<StagingBuffer> m_Staging;
+
+        uint32_t m_Layers = 0;
+        vk::Image m_vkPages = nullptr;
+        vma::Allocation m_vmaPagesAllocation = nullptr;
+        vk::ImageView m_vkPagesView = nullptr;
+        RetiredImage m_Retired;
+    };
+
+}
@@ -0,0 +1,286 @@
+#include "safpch.h"
+#include "glyphkernels.h"
+
+#include "render/renderer2d.h"
+#include "utils/benchmark.h"
+#include "utils/cpufeatures.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef SAF_X86
+    #include <immintrin.h>
+#endif
+
+namespace saf {
+
+    static_assert(sizeof(GlyphInstance) == 8 * sizeof(uint32_t), "The SIMD kernels store a GlyphInstance as eight 32 bit lanes");
+
+    GlyphStyle GlyphStyle::Make(glm::vec4 color, float rotation)
+    {
+        GlyphStyle style;
+        style.cos = std::cos(rotation);
+        style.sin = std::sin(rotation);
+        style.color = glm::packUnorm4x8(color);
+        style.rotation = glm::packHalf2x16(glm::vec2(std::remainder(rotation, glm::two_pi<float>()), 0.f)) & 0xFFFF;
+        return style;
+    }
+
+    void GlyphRun::Clear()
+    {
+        Resize(0);
+    }
+
+    void GlyphRun::Resize(size_t size)
+    {
+        for (auto* field : { &origin_x, &origin_y, &offset_x, &offset_y, &cos, &sin, &width, &height, &s0, &t0, &s1, &t1 }) field->resize(size);
+        color.resize(size);
+        rotation_layer.resize(size);
+    }
+
+    void GlyphRun::Reserve(size_t size)
+    {
+        for (auto* field : { &origin_x, &origin_y, &offset_x, &offset_y, &cos, &sin, &width, &height, &s0, &t0, &s1, &t1 }) field->reserve(size);
+        color.reserve(size);
+        rotation_layer.reserve(size);
+    }
+
+    void GlyphRun::Push(glm::vec2 origin, glm::vec2 offset, glm::vec2 size, glm::vec4 uv, const GlyphStyle& style, uint32_t page)
+    {
+        origin_x.push_back(origin.x);
+        origin_y.push_back(origin.y);
+        offset_x.push_back(offset.x);
+        offset_y.push_back(offset.y);
+        cos.push_back(style.cos);
+        sin.push_back(style.sin);
+        width.push_back(size.x);
+        height.push_back(size.y);
+        s0.push_back(uv.x);
+        t0.push_back(uv.y);
+        s1.push_back(uv.z);
+        t1.push_back(uv.w);
+        color.push_back(style.color);
+        rotation_layer.push_back(style.rotation | ((page & 0xFF) << 16));
+    }
+
+    static inline void TransformGlyph(const GlyphRun& run, size_t i, GlyphInstance& instance)
+    {
+        instance.center.x = run.origin_x[i] + (run.cos[i] * run.offset_x[i] - run.sin[i] * run.offset_y[i]);
+        instance.center.y = run.origin_y[i] + (run.sin[i] * run.offset_x[i] + run.cos[i] * run.offset_y[i]);
+        instance.size = glm::vec2(run.width[i], run.height[i]);
+        instance.uv[0] = PackUnorm16x2(run.s0[i], run.t0[i]);
+        instance.uv[1] = PackUnorm16x2(run.s1[i], run.t1[i]);
+        instance.color = run.color[i];
+        instance.rotation = static_cast<uint16_t>(run.rotation_layer[i] & 0xFFFF);
+        instance.layer = static_cast<uint8_t>(run.rotation_layer[i] >> 16);
+        instance.padding = 0;
+    }
+
+    static void TransformGlyphsScalar(const GlyphRun& run, GlyphInstance* out)
+    {
+        for (size_t i = 0; i < run.Size(); ++i) TransformGlyph(run, i, out[i]);
+    }
+
+#ifdef SAF_X86
+
+    SAF_TARGET("avx2")
+    static inline __m256i Unorm16AVX2(__m256 low, __m256 high)
+    {
+        const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.f), scale = _mm256_set1_ps(65535.f);
+        const __m256i l = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(low, zero), one), scale));
+        const __m256i h = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(high, zero), one), scale));
+        return _mm256_or_si256(l, _mm256_slli_epi32(h, 16));
+    }
+
+    // Eight glyphs per iteration: the eight fields are computed as one vector each, then an 8x8 transpose turns them into eight instances
+    SAF_TARGET("avx2")
+    static void TransformGlyphsAVX2(const GlyphRun& run, GlyphInstance* out)
+    {
+        const size_t count = run.Size();
+        const size_t simd_count = count & ~static_cast<size_t>(7);
+
+        size_t i = 0;
+        for (; i < simd_count; i += 8)
+        {
+            const __m256 c = _mm256_loadu_ps(run.cos.data() + i);
+            const __m256 s = _mm256_loadu_ps(run.sin.data() + i);
+            const __m256 dx = _mm256_loadu_ps(run.offset_x.data() + i);
+            const __m256 dy = _mm256_loadu_ps(run.offset_y.data() + i);
+
+            const __m256 r0 = _mm256_add_ps(_mm256_loadu_ps(run.origin_x.data() + i), _mm256_sub_ps(_mm256_mul_ps(c, dx), _mm256_mul_ps(s, dy)));
+            const __m256 r1 = _mm256_add_ps(_mm256_loadu_ps(run.origin_y.data() + i), _mm256_add_ps(_mm256_mul_ps(s, dx), _mm256_mul_ps(c, dy)));
+            const __m256 r2 = _mm256_loadu_ps(run.width.data() + i);
+            const __m256 r3 = _mm256_loadu_ps(run.height.data() + i);
+            const __m256 r4 = _mm256_castsi256_ps(Unorm16AVX2(_mm256_loadu_ps(run.s0.data() + i), _mm256_loadu_ps(run.t0.data() + i)));
+            const __m256 r5 = _mm256_castsi256_ps(Unorm16AVX2(_mm256_loadu_ps(run.s1.data() + i), _mm256_loadu_ps(run.t1.data() + i)));
+            const __m256 r6 = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(run.color.data() + i)));
+            const __m256 r7 = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(run.rotation_layer.data() + i)));
+
+            const __m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+            const __m256 t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+            const __m256 t4 = _mm256_unpacklo_ps(r4, r5), t5 = _mm256_unpackhi_ps(r4, r5);
+            const __m256 t6 = _mm256_unpacklo_ps(r6, r7), t7 = _mm256_unpackhi_ps(r6, r7);
+
+            const __m256 u0 = _mm256_shuffle_ps(t0, t2, 0x44), u1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+            const __m256 u2 = _mm256_shuffle_ps(t1, t3, 0x44), u3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+            const __m256 u4 = _mm256_shuffle_ps(t4, t6, 0x44), u5 = _mm256_shuffle_ps(t4, t6, 0xEE);
+            const __m256 u6 = _mm256_shuffle_ps(t5, t7, 0x44), u7 = _mm256_shuffle_ps(t5, t7, 0xEE);
+
+            float* destination = reinterpret_cast<float*>(out + i);
+            _mm256_storeu_ps(destination + 0 * 8, _mm256_permute2f128_ps(u0, u4, 0x20));
+            _mm256_storeu_ps(destination + 1 * 8, _mm256_permute2f128_ps(u1, u5, 0x20));
+            _mm256_storeu_ps(destination + 2 * 8, _mm256_permute2f128_ps(u2, u6, 0x20));
+            _mm256_storeu_ps(destination + 3 * 8, _mm256_permute2f128_ps(u3, u7, 0x20));
+            _mm256_storeu_ps(destination + 4 * 8, _mm256_permute2f128_ps(u0, u4, 0x31));
+            _mm256_storeu_ps(destination + 5 * 8, _mm256_permute2f128_ps(u1, u5, 0x31));
+            _mm256_storeu_ps(destination + 6 * 8, _mm256_permute2f128_ps(u2, u6, 0x31));
+            _mm256_storeu_ps(destination + 7 * 8, _mm256_permute2f128_ps(u3, u7, 0x31));
+        }
+
+        for (; i < count; ++i) TransformGlyph(run, i, out[i]);
+    }
+
+    static const GlyphKernels s_AVX2Kernels{ "avx2", TransformGlyphsAVX2 };
+
+#endif
+
+    static const GlyphKernels s_ScalarKernels{ "scalar", TransformGlyphsScalar };
+
+    std::vector<const GlyphKernels*> GetSupportedGlyphKernels()
+    {
+        std::vector<const GlyphKernels*> kernels{ &s_ScalarKernels };
+#ifdef SAF_X86
+        if (GetCpuFeatures().avx2) kernels.push_back(&s_AVX2Kernels);
+#endif
+        return kernels;
+    }
+
+    // Deterministic run with a bit of everything: rotated and straight glyphs, UVs outside [0, 1], several pages
+    static void FillTestRun(GlyphRun& run, uint32_t glyphs)
+    {
+        run.Clear();
+        run.Reserve(glyphs);
+
+        uint32_t seed = 0x9E3779B9U;
+        auto next = [&seed]() { seed = seed * 1664525U + 1013904223U; return static_cast<float>(seed >> 8) / static_cast<float>(1U << 24); };
+
+        GlyphStyle style = GlyphStyle::Make(glm::vec4(1.f), 0.f);
+        for (uint32_t i = 0; i < glyphs; ++i)
+        {
+            if (i % 64 == 0) style = GlyphStyle::Make(glm::vec4(next(), next(), next(), 1.f), i % 128 == 0 ? 0.f : next() * 20.f - 10.f);
+            run.Push(glm::vec2(next() * 1920.f, next() * 1080.f), glm::vec2(next() * 8.f, next() * 64.f), glm::vec2(next() * 40.f, next() * 64.f),
+                glm::vec4(next() * 1.1f - 0.05f, next(), next(), next() * 1.1f - 0.05f), style, i % 16);
+        }
+    }
+
+    bool ValidateGlyphKernels()
+    {
+        bool valid = true;
+        GlyphRun run;
+        for (uint32_t glyphs : { 1U, 7U, 8U, 29U, 300U })
+        {
+            FillTestRun(run, glyphs);
+
+            std::vector<GlyphInstance> expected(glyphs), out(glyphs);
+            std::memset(expected.data(), 0, glyphs * sizeof(GlyphInstance));
+            s_ScalarKernels.transform(run, expected.data());
+
+            for (const GlyphKernels* kernels : GetSupportedGlyphKernels())
+            {
+                std::memset(out.data(), 0xCD, glyphs * sizeof(GlyphInstance));
+                kernels->transform(run, out.data());
+
+                if (std::memcmp(out.data(), expected.data(), glyphs * sizeof(GlyphInstance)) != 0)
+                {
+                    IFX_WARN("Glyph {0} kernels differ from scalar reference (glyphs = {1})", kernels->name, glyphs);
+                    valid = false;
+                }
+            }
+        }
+        return valid;
+    }
+
+    const GlyphKernels& GetGlyphKernels()
+    {
+        static const GlyphKernels& kernels = []() -> const GlyphKernels&
+            {
+#ifdef SAF_DEBUG
+                if (!ValidateGlyphKernels()) IFX_ERROR("Glyph kernels differ from scalar reference");
+#endif
+                const GlyphKernels& selected = *GetSupportedGlyphKernels().back();
+                IFX_TRACE("Glyph transform using {0} kernels", selected.name);
+                return selected;
+            }();
+        return kernels;
+    }
+
+    void BenchmarkGlyphKernels(uint32_t glyphs, uint32_t frames)
+    {
+        GlyphRun source;
+        FillTestRun(source, glyphs);
+
+        // The old path took the font's angle as is, recovering it from cos / sin inside the loop would bill it for an atan2 it never did
+        std::vector<float> angles(glyphs);
+        for (uint32_t i = 0; i < glyphs; ++i) angles[i] = std::atan2(source.sin[i], source.cos[i]);
+
+        std::vector<GlyphInstance> out(glyphs);
+        BenchmarkTimer timer(frames, glyphs);
+        auto report = [&timer, &out](const char* name)
+            {
+                timer.Stop();
+                timer.Report(name, "glyph");
+
+                // Reading the output keeps the compiler from dropping the work
+                uint32_t check = 0;
+                for (const GlyphInstance& instance : out) check ^= instance.uv[0] ^ instance.color;
+                IFX_TRACE("\t{0} output check {1:x}", name, check);
+            };
+
+        IFX_INFO("Glyph transform, {0} glyphs per frame over {1} frames", glyphs, frames);
+
+        // What DrawString did per glyph before the run: a rotation matrix, a matrix vector product and a Pack
+        timer.Start();
+        for (uint32_t frame = 0; frame < frames; ++frame)
+        {
+            for (uint32_t i = 0; i < glyphs; ++i)
+            {
+                const float angle = angles[i];
+                glm::mat4 rotation = glm::rotate(glm::mat4(1.f), angle, glm::vec3(0.f, 0.f, 1.f));
+                glm::vec2 center = glm::vec2(source.origin_x[i], source.origin_y[i]) + glm::vec2(rotation * glm::vec4(source.offset_x[i], source.offset_y[i], 0.f, 1.f));
+                out[i] = GlyphInstance::Pack(center, glm::vec2(source.width[i], source.height[i]), glm::vec4(source.s0[i], source.t0[i], source.s1[i], source.t1[i]),
+                    glm::unpackUnorm4x8(source.color[i]), angle, source.rotation_layer[i] >> 16);
+            }
+        }
+        report("per glyph matrices");
+
+        // The run path, filling the arrays is part of the cost
+        GlyphRun run;
+        run.Reserve(glyphs);
+        for (const GlyphKernels* kernels : GetSupportedGlyphKernels())
+        {
+            timer.Start();
+            for (uint32_t frame = 0; frame < frames; ++frame)
+            {
+                run.Clear();
+                GlyphStyle style;
+                for (uint32_t i = 0; i < glyphs; ++i)
+                {
+                    style.cos = source.cos[i];
+                    style.sin = source.sin[i];
+                    style.color = source.color[i];
+                    style.rotation = source.rotation_layer[i] & 0xFFFF;
+                    run.Push(glm::vec2(source.origin_x[i], source.origin_y[i]), glm::vec2(source.offset_x[i], source.offset_y[i]), glm::vec2(source.width[i], source.height[i]),
+                        glm::vec4(source.s0[i], source.t0[i], source.s1[i], source.t1[i]), style, source.rotation_layer[i] >> 16);
+                }
+                kernels->transform(run, out.data());
+            }
+            report(kernels->name);
+        }
+    }
+
+}
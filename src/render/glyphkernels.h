@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace saf {
+
+    struct GlyphInstance;
+
+    // Per font values of a GlyphRun, computed once and shared by every glyph until the font changes
+    struct GlyphStyle
+    {
+        float cos = 1.f, sin = 0.f;
+        uint32_t color = 0;
+        uint32_t rotation = 0; // half float radians, wrapped to [-pi, pi]
+
+        static GlyphStyle Make(glm::vec4 color, float rotation);
+    };
+
+    // low | high << 16 as unorm16, clamped to [0, 1] and rounded to nearest even like _mm256_cvtps_epi32.
+    // GlyphInstance::Pack uses it too, glm::packUnorm2x16 rounds halves away from zero and would disagree with the kernels.
+    inline uint32_t PackUnorm16x2(float low, float high)
+    {
+        const uint32_t l = static_cast<uint32_t>(std::nearbyint(std::min(std::max(low, 0.f), 1.f) * 65535.f));
+        const uint32_t h = static_cast<uint32_t>(std::nearbyint(std::min(std::max(high, 0.f), 1.f) * 65535.f));
+        return l | (h << 16);
+    }
+
+    /*
+    * The glyphs of one DrawString layout as structure of arrays, filled glyph by glyph by the layout pass
+    * and turned into GlyphInstances in one go by GlyphKernels::transform.
+    *
+    *   center = origin + rotate(offset, cos, sin)
+    *
+    * origin is the pen position plus half the glyph size plus the font translation, offset the glyph's box offset.
+    * color and rotation_layer are already packed (RGBA8, half float angle | page << 16), they only change with the font.
+    */
+    struct GlyphRun
+    {
+        std::vector<float> origin_x, origin_y;
+        std::vector<float> offset_x, offset_y;
+        std::vector<float> cos, sin;
+        std::vector<float> width, height;
+        std::vector<float> s0, t0, s1, t1;
+        std::vector<uint32_t> color;
+        std::vector<uint32_t> rotation_layer;
+
+        inline size_t Size() const { return origin_x.size(); }
+
+        void Clear();
+        void Resize(size_t size);
+        void Reserve(size_t size);
+        void Push(glm::vec2 origin, glm::vec2 offset, glm::vec2 size, glm::vec4 uv, const GlyphStyle& style, uint32_t page);
+    };
+
+    /*
+    * transform: out[i] = GlyphInstance of run glyph i, for i < run.Size()
+    *
+    * Every implementation rounds the same way (unorm UVs to nearest even), so all of them produce bit identical output to the scalar one.
+    */
+    struct GlyphKernels
+    {
+        const char* name;
+        void (*transform)(const GlyphRun& run, GlyphInstance* out);
+    };
+
+    // The AVX2 transform when the CPU has it, else the scalar one. Chosen on the first DrawString that misses the layout cache.
+    const GlyphKernels& GetGlyphKernels();
+
+    // Scalar, then AVX2 where available, the sets ValidateGlyphKernels() and BenchmarkGlyphKernels() go through.
+    std::vector<const GlyphKernels*> GetSupportedGlyphKernels();
+
+    // Transforms random runs sized around the 8 glyph AVX2 step (1, 7, 8, 29, 300 glyphs) with every set and compares
+    // the GlyphInstances byte for byte with the scalar ones. Debug builds run it before GetGlyphKernels() picks a set.
+    bool ValidateGlyphKernels();
+
+    // Times the per glyph matrix path DrawString used before against every supported kernel set, glyphs per frame over frames, and logs the results.
+    void BenchmarkGlyphKernels(uint32_t glyphs, uint32_t frames);
+
+}
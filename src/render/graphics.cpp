@@ -24,21 +24,52 @@
 
 namespace saf {
 
-    FrameManager::FrameManager(uint32_t width, uint32_t height)
-        : m_Width(width), m_Height(height)
+    FrameManager::FrameManager(uint32_t width, uint32_t height, uint32_t frames_in_flight)
+        : m_Width(width), m_Height(height), m_FramesInFlight(std::clamp(frames_in_flight, 1U, s_MaxFramesInFlight))
     {
-
+        if (m_FramesInFlight != frames_in_flight) IFX_WARN("FrameManager supports 1 to {0} frames in flight, using {1}", s_MaxFramesInFlight, m_FramesInFlight);
     }
 
     void FrameManager::Init()
     {
+        CreateFrames();
         CreateSwapchain();
     }
     
     void FrameManager::Destroy()
     {
-        for (auto semiphore : m_vkRecycleSemaphores) if (semiphore) global::g_Device.destroySemaphore(semiphore);
+        if (global::g_Device) global::g_Device.waitIdle();
+        RunDeferred(true);
         if (m_vkSwapchainData.swapchain) DestroySwapchain(m_vkSwapchainData.swapchain);
+        DestroyFrames();
+    }
+
+    void FrameManager::CreateFrames()
+    {
+        IFX_TRACE("FrameManager {0} frames in flight", m_FramesInFlight);
+
+        m_vkFramesData.resize(m_FramesInFlight);
+        for (auto& frame_data : m_vkFramesData)
+        {
+            frame_data.queue_submit_fence = global::g_Device.createFence({ vk::FenceCreateFlagBits::eSignaled });
+            frame_data.primary_command_pool = global::g_Device.createCommandPool({ vk::CommandPoolCreateFlagBits::eTransient, global::g_GraphicsQueueIndex });
+            vk::CommandBufferAllocateInfo command_buffer_allocate_info(frame_data.primary_command_pool, vk::CommandBufferLevel::ePrimary, 1);
+            frame_data.primary_command_buffer = global::g_Device.allocateCommandBuffers(command_buffer_allocate_info).front();
+            frame_data.swapchain_acquire_semaphore = global::g_Device.createSemaphore({});
+        }
+        m_FrameIndex = 0;
+    }
+
+    void FrameManager::DestroyFrames()
+    {
+        for (auto& frame_data : m_vkFramesData)
+        {
+            if (frame_data.queue_submit_fence) global::g_Device.destroyFence(frame_data.queue_submit_fence);
+            if (frame_data.primary_command_buffer) global::g_Device.freeCommandBuffers(frame_data.primary_command_pool, frame_data.primary_command_buffer);
+            if (frame_data.primary_command_pool) global::g_Device.destroyCommandPool(frame_data.primary_command_pool);
+            if (frame_data.swapchain_acquire_semaphore) global::g_Device.destroySemaphore(frame_data.swapchain_acquire_semaphore);
+        }
+        m_vkFramesData.clear();
     }
 
     void FrameManager::Resize(uint32_t width, uint32_t height)
@@ -46,77 +77,110 @@ namespace saf {
         if (width == m_Width && height == m_Height) return;
         m_Width = width;
         m_Height = height;
-        global::g_Device.waitIdle();
-        CreateSwapchain();
+        m_SwapchainDirty = true;
     }
 
-    bool FrameManager::Render(std::shared_ptr<Renderer2D> renderer2d, const glm::mat4& projection)
+    void FrameManager::Defer(std::function<void()> destroy)
     {
+        m_DeferredDestroys.push_back({ m_SubmitSerial + 1, std::move(destroy) });
+    }
 
-        vk::Semaphore acquire_semaphore;
-        if (m_vkRecycleSemaphores.empty())
+    void FrameManager::RunDeferred(bool all)
+    {
+        while (!m_DeferredDestroys.empty() && (all || m_DeferredDestroys.front().serial <= m_CompletedSerial))
         {
-            acquire_semaphore = global::g_Device.createSemaphore({});
+            m_DeferredDestroys.front().destroy();
+            m_DeferredDestroys.pop_front();
         }
-        else
+    }
+
+    void FrameManager::WaitForSerial(uint64_t serial)
+    {
+        if (serial <= m_CompletedSerial) return;
+
+        // The oldest submit at or past serial, frames recycled since then only carry later serials
+        FrameData* oldest = nullptr;
+        for (auto& frame_data : m_vkFramesData)
         {
-            acquire_semaphore = m_vkRecycleSemaphores.back();
-            m_vkRecycleSemaphores.pop_back();
+            if (frame_data.submit_serial >= serial && (!oldest || frame_data.submit_serial < oldest->submit_serial)) oldest = &frame_data;
         }
 
-        vk::Result res;
-        uint32_t   index;
-        std::tie(res, index) = global::g_Device.acquireNextImageKHR(m_vkSwapchainData.swapchain, UINT64_MAX, acquire_semaphore);
-
-        if (res != vk::Result::eSuccess)
+        if (oldest)
         {
-            m_vkRecycleSemaphores.push_back(acquire_semaphore);
-            IFX_WARN("Vulkan failed acquireNextImage");
-            global::g_GraphicsQueue.waitIdle();
-            return false;
+            (void)global::g_Device.waitForFences(oldest->queue_submit_fence, true, UINT64_MAX);
+            m_CompletedSerial = oldest->submit_serial;
         }
         else
         {
-            // If we have outstanding fences for this swapchain image, wait for them to complete first.
-            // After begin frame returns, it is safe to reuse or delete resources which
-            // were used previously.
-            //
-            // We wait for fences which completes N frames earlier, so we do not stall,
-            // waiting for all GPU work to complete before this returns.
-            // Normally, this doesn't really block at all,
-            // since we're waiting for old frames to have been completed, but just in case.
-            if (m_vkFramesData[index].queue_submit_fence)
-            {
-                (void)global::g_Device.waitForFences(m_vkFramesData[index].queue_submit_fence, true, UINT64_MAX);
-                global::g_Device.resetFences(m_vkFramesData[index].queue_submit_fence);
-            }
+            // Not submitted by any frame in flight, so it is older than all of them and their fences cover it
+            m_CompletedSerial = std::max(m_CompletedSerial, serial);
+        }
+    }
 
-            if (m_vkFramesData[index].primary_command_pool)
-            {
-                global::g_Device.resetCommandPool(m_vkFramesData[index].primary_command_pool);
-            }
+    bool FrameManager::Render(std::shared_ptr<Renderer2D> renderer2d, const glm::mat4& projection)
+    {
+        FrameData& frame = m_vkFramesData[m_FrameIndex];
 
-            // Recycle the old semaphore back into the semaphore manager.
-            vk::Semaphore old_semaphore = m_vkFramesData[index].swapchain_acquire_semaphore;
+        // The slot's last submit was frames_in_flight frames ago. Waiting for it is what keeps the CPU
+        // at most that many frames ahead of the GPU, and frees the slot's command pool and staging memory.
+        (void)global::g_Device.waitForFences(frame.queue_submit_fence, true, UINT64_MAX);
+        m_CompletedSerial = std::max(m_CompletedSerial, frame.submit_serial);
+        RunDeferred();
 
-            if (old_semaphore)
+        // The layers drew and ImGui began a frame before we knew whether there is an image to render to,
+        // a frame that is skipped has to drop both or they pile up until the next frame that presents
+        auto skip_frame = [&renderer2d]()
             {
-                m_vkRecycleSemaphores.push_back(old_semaphore);
-            }
+                renderer2d->Discard();
+                ImGui::EndFrame();
+                return false;
+            };
+
+        // Out of date swapchains are replaced here, between frames, without waiting for the device
+        if (m_SwapchainDirty && !CreateSwapchain()) return skip_frame();
 
-            m_vkFramesData[index].swapchain_acquire_semaphore = acquire_semaphore;
+        // On failure nothing was acquired and the fence was not reset, the slot is picked up again as it is next frame
+        vk::Result res;
+        uint32_t   index;
+        try
+        {
+            std::tie(res, index) = global::g_Device.acquireNextImageKHR(m_vkSwapchainData.swapchain, UINT64_MAX, frame.swapchain_acquire_semaphore);
+        }
+        catch (const vk::OutOfDateKHRError&)
+        {
+            m_SwapchainDirty = true;
+            return skip_frame();
         }
 
-        vk::CommandBuffer cmd = m_vkFramesData[index].primary_command_buffer;
+        if (res == vk::Result::eSuboptimalKHR)
+        {
+            // Still presentable, draw this frame and replace the swapchain before the next
+            m_SwapchainDirty = true;
+        }
+        else if (res != vk::Result::eSuccess)
+        {
+            IFX_WARN("Vulkan failed acquireNextImage ({0})", vk::to_string(res));
+            return skip_frame();
+        }
+
+        global::g_Device.resetFences(frame.queue_submit_fence);
+        global::g_Device.resetCommandPool(frame.primary_command_pool);
+
+        vk::CommandBuffer cmd = frame.primary_command_buffer;
 
         // We will only submit this once before it's recycled.
         vk::CommandBufferBeginInfo begin_info(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
         // Begin command recording
 
-        vk::Image swapchain_image = global::g_Device.getSwapchainImagesKHR(m_vkSwapchainData.swapchain)[index];
+        vk::Image swapchain_image = m_vkSwapchainData.images[index];
 
         cmd.begin(begin_info);
 
+        // Glyph uploads are transfers, they have to be recorded before rendering begins.
+        // Staging is per frame in flight, the fence wait above freed this slot's. A grown glyph image
+        // is copied in this submit and the image it replaces is destroyed once the submit completes.
+        renderer2d->Upload(cmd, m_FrameIndex, [this](std::function<void()> destroy) { Defer(std::move(destroy)); });
+
         vk::ImageMemoryBarrier image_memory_barrier(
             vk::AccessFlagBits::eNone,
             vk::AccessFlagBits::eColorAttachmentWrite,
@@ -173,39 +237,55 @@ namespace saf {
         // Complete the command buffer.
         cmd.end();
 
-        // Submit it to the queue with a release semaphore.
-        if (!m_vkFramesData[index].swapchain_release_semaphore)
-        {
-            m_vkFramesData[index].swapchain_release_semaphore = global::g_Device.createSemaphore({});
-        }
+        // Submit it to the queue with the image's release semaphore.
+        vk::Semaphore release_semaphore = m_vkSwapchainData.release_semaphores[index];
 
         vk::PipelineStageFlags wait_stage{ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 
         vk::SubmitInfo info(
-            m_vkFramesData[index].swapchain_acquire_semaphore,
+            frame.swapchain_acquire_semaphore,
             wait_stage,
             cmd,
-            m_vkFramesData[index].swapchain_release_semaphore
+            release_semaphore
         );
         // Submit command buffer to graphics queue
-        global::g_GraphicsQueue.submit(info, m_vkFramesData[index].queue_submit_fence);
+        global::g_GraphicsQueue.submit(info, frame.queue_submit_fence);
+        frame.submit_serial = ++m_SubmitSerial;
+        m_FrameIndex = (m_FrameIndex + 1) % m_FramesInFlight;
 
         // Present swapchain image
-        vk::PresentInfoKHR present_info(m_vkFramesData[index].swapchain_release_semaphore, m_vkSwapchainData.swapchain, index);
-        res = global::g_GraphicsQueue.presentKHR(present_info);
-
-        if (res != vk::Result::eSuccess)
+        vk::PresentInfoKHR present_info(release_semaphore, m_vkSwapchainData.swapchain, index);
+        try
         {
-            IFX_ERROR("Failed to present swapchain image.");
+            res = global::g_GraphicsQueue.presentKHR(present_info);
         }
-        
+        catch (const vk::OutOfDateKHRError&)
+        {
+            res = vk::Result::eErrorOutOfDateKHR;
+        }
+
+        if (res == vk::Result::eSuboptimalKHR || res == vk::Result::eErrorOutOfDateKHR) m_SwapchainDirty = true;
+        else if (res != vk::Result::eSuccess) IFX_ERROR("Failed to present swapchain image.");
+
+        // The renderer's next instance region was last read by an older submit, usually long finished.
+        // Waiting on that submit alone lets the CPU build the next frame while the GPU still draws this one,
+        // and waiting only after presenting keeps a slow region from delaying this frame's image.
+        WaitForSerial(renderer2d->NextFrame(m_SubmitSerial));
+
         return true;
     }
 
-    void FrameManager::CreateSwapchain()
+    bool FrameManager::CreateSwapchain()
     {
         IFX_TRACE("Window CreateSwapchain");
         vk::SurfaceCapabilitiesKHR capabilities = global::g_PhysicalDevice.getSurfaceCapabilitiesKHR(global::g_Surface);
+
+        // A minimized window has no extent to create a swapchain with, keep the old one until it is restored
+        if (m_Width == 0 || m_Height == 0 || capabilities.currentExtent.width == 0 || capabilities.currentExtent.height == 0)
+        {
+            m_SwapchainDirty = true;
+            return false;
+        }
         std::vector<vk::PresentModeKHR> supported_preset_modes = global::g_PhysicalDevice.getSurfacePresentModesKHR(global::g_Surface);
 
         if (supported_preset_modes.size() == 0) IFX_ERROR("Vulkan surface doesnt support any presentModes?");
@@ -249,9 +329,11 @@ namespace saf {
         m_vkSwapchainData.extent = extent;
         vk::SwapchainKHR old_swapchain = m_vkSwapchainData.swapchain;
 
+        // FIFO is always supported
         vk::PresentModeKHR present_mode = vk::PresentModeKHR::eFifo;
         for (const auto mode : supported_preset_modes)
         {
+            if (m_Vsync) break;
             if (mode == vk::PresentModeKHR::eMailbox)
             {
                 present_mode = mode;
@@ -259,7 +341,8 @@ namespace saf {
             }
         }
 
-        if (present_mode == vk::PresentModeKHR::eFifo) IFX_TRACE("Vulkan physical device doesnt support mailbox present mode, defaulting to FiFo");
+        if (m_Vsync) IFX_TRACE("Vulkan using FiFo present mode, frames are paced by presentation");
+        else if (present_mode == vk::PresentModeKHR::eFifo) IFX_TRACE("Vulkan physical device doesnt support mailbox present mode, defaulting to FiFo");
         else IFX_TRACE("Vulkan using mailbox present mode");
 
         vk::SwapchainCreateInfoKHR swapchain_create_info(
@@ -283,26 +366,29 @@ namespace saf {
 
         m_vkSwapchainData.swapchain = global::g_Device.createSwapchainKHR(swapchain_create_info);
         if (!m_vkSwapchainData.swapchain) IFX_ERROR("Vulkan failed to create swapchain");
+        m_SwapchainDirty = false;
 
-        DestroySwapchain(old_swapchain);
-
-        std::vector<vk::Image> swapchain_images = global::g_Device.getSwapchainImagesKHR(m_vkSwapchainData.swapchain);
-        size_t image_count = swapchain_images.size();
-
-        // Initialize per-frame resources.
-        // Every swapchain image has its own command pool and fence manager.
-        // This makes it very easy to keep track of when we can reset command buffers and such.
-        m_vkFramesData.clear();
-        m_vkFramesData.resize(image_count);
-
-        for (auto& frame_data : m_vkFramesData)
+        // Frames still in flight render to the old views, and the old release semaphores are waited on by
+        // presents no fence tracks. Everything of the old swapchain is destroyed once a submit made after
+        // this point has completed, the presents queued before it are done by then.
+        if (old_swapchain)
         {
-            frame_data.queue_submit_fence = global::g_Device.createFence({ vk::FenceCreateFlagBits::eSignaled });
-            frame_data.primary_command_pool = global::g_Device.createCommandPool({ vk::CommandPoolCreateFlagBits::eTransient, global::g_GraphicsQueueIndex });
-            vk::CommandBufferAllocateInfo command_buffer_allocate_info(frame_data.primary_command_pool, vk::CommandBufferLevel::ePrimary, 1);
-            frame_data.primary_command_buffer = global::g_Device.allocateCommandBuffers(command_buffer_allocate_info).front();
+            Defer([old_swapchain, image_views = std::move(m_vkSwapchainData.image_views), release_semaphores = std::move(m_vkSwapchainData.release_semaphores)]()
+                {
+                    for (vk::ImageView image_view : image_views) global::g_Device.destroyImageView(image_view);
+                    for (vk::Semaphore semaphore : release_semaphores) global::g_Device.destroySemaphore(semaphore);
+                    global::g_Device.destroySwapchainKHR(old_swapchain);
+                });
+            m_vkSwapchainData.image_views.clear();
+            m_vkSwapchainData.release_semaphores.clear();
         }
 
+        // Cached for the swapchain's lifetime, Render only indexes them
+        m_vkSwapchainData.images = global::g_Device.getSwapchainImagesKHR(m_vkSwapchainData.swapchain);
+        const std::vector<vk::Image>& swapchain_images = m_vkSwapchainData.images;
+        size_t image_count = swapchain_images.size();
+        IFX_TRACE("Vulkan swapchain has {0} images, {1} frames in flight", image_count, m_FramesInFlight);
+
         for (size_t i = 0; i < image_count; i++)
         {
             // Create an image view which we can render into.
@@ -317,7 +403,10 @@ namespace saf {
             if (!image_view) IFX_ERROR("Vulkan failed to create imageview");
 
             m_vkSwapchainData.image_views.push_back(image_view);
+            m_vkSwapchainData.release_semaphores.push_back(global::g_Device.createSemaphore({}));
         }
+
+        return true;
     }
 
     void FrameManager::DestroySwapchain(vk::SwapchainKHR swapchain)
@@ -327,38 +416,9 @@ namespace saf {
         for (vk::ImageView image_view : m_vkSwapchainData.image_views) { global::g_Device.destroyImageView(image_view); }
         m_vkSwapchainData.image_views.clear();
 
-        for (auto& frame_data : m_vkFramesData) {
-            if (frame_data.queue_submit_fence)
-            {
-                global::g_Device.destroyFence(frame_data.queue_submit_fence);
-                frame_data.queue_submit_fence = nullptr;
-            }
-
-            if (frame_data.primary_command_buffer)
-            {
-                global::g_Device.freeCommandBuffers(frame_data.primary_command_pool, frame_data.primary_command_buffer);
-                frame_data.primary_command_buffer = nullptr;
-            }
-
-            if (frame_data.primary_command_pool)
-            {
-                global::g_Device.destroyCommandPool(frame_data.primary_command_pool);
-                frame_data.primary_command_pool = nullptr;
-            }
-
-            if (frame_data.swapchain_acquire_semaphore)
-            {
-                global::g_Device.destroySemaphore(frame_data.swapchain_acquire_semaphore);
-                frame_data.swapchain_acquire_semaphore = nullptr;
-            }
-
-            if (frame_data.swapchain_release_semaphore)
-            {
-                global::g_Device.destroySemaphore(frame_data.swapchain_release_semaphore);
-                frame_data.swapchain_release_semaphore = nullptr;
-            }
-        }
-        m_vkFramesData.clear();
+        for (vk::Semaphore semaphore : m_vkSwapchainData.release_semaphores) { global::g_Device.destroySemaphore(semaphore); }
+        m_vkSwapchainData.release_semaphores.clear();
+        m_vkSwapchainData.images.clear();
 
         global::g_Device.destroySwapchainKHR(swapchain);
     }
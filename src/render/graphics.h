@@ -1,6 +1,8 @@
 #pragma once
 
 #include <array>
+#include <deque>
+#include <functional>
 #include <vector>
 
 #include <vulkan/vulkan.hpp>
@@ -30,39 +32,76 @@ namespace saf {
         vk::Extent2D                 extent{ UINT32_MAX, UINT32_MAX };
         vk::Format                   format = vk::Format::eUndefined;
         vk::SwapchainKHR             swapchain = nullptr;
+        std::vector<vk::Image>       images;                // fetched once per swapchain
         std::vector<vk::ImageView>   image_views;
+        std::vector<vk::Semaphore>   release_semaphores;    // per image, presentation holds it until the image comes back
     };
 
+    // One frame the CPU may record while the GPU still works on the others, independent of the swapchain
     struct FrameData
     {
         vk::Fence         queue_submit_fence;
         vk::CommandPool   primary_command_pool;
         vk::CommandBuffer primary_command_buffer;
         vk::Semaphore     swapchain_acquire_semaphore;
-        vk::Semaphore     swapchain_release_semaphore;
+        uint64_t          submit_serial = 0;
     };
 
     class FrameManager
     {
     public:
-        FrameManager(uint32_t width, uint32_t height);
+        static constexpr uint32_t s_DefaultFramesInFlight = 2;
+        // ImGui is initialized with 3 frames of buffers and the renderer rings 3 instance regions
+        static constexpr uint32_t s_MaxFramesInFlight = 3;
+
+        FrameManager(uint32_t width, uint32_t height, uint32_t frames_in_flight = s_DefaultFramesInFlight);
 
         void Init();
 
+        // Only records the size, the next Render recreates the swapchain
         void Resize(uint32_t width, uint32_t height);
-        void CreateSwapchain();
+        // false when the surface has no area (minimized), the swapchain is then recreated once it has
+        bool CreateSwapchain();
         void DestroySwapchain(vk::SwapchainKHR old_swapchain);
 
         bool Render(std::shared_ptr<Renderer2D> renderer2d, const glm::mat4& projection);
 
+        // FIFO presentation instead of mailbox, so presenting blocks until vblank. Used by the next CreateSwapchain.
+        inline void SetVsync(bool vsync) { m_Vsync = vsync; }
+
         void Destroy();
+
+        // Submits are numbered from 1 in order, one queue completes them in that order
+        inline uint64_t GetSubmitSerial() const { return m_SubmitSerial; }
+        void WaitForSerial(uint64_t serial);
     private:
         uint32_t m_Width{};
         uint32_t m_Height{};
 
+        void CreateFrames();
+        void DestroyFrames();
+
+        // destroy runs once every submit made so far and the next one have completed, see CreateSwapchain
+        void Defer(std::function<void()> destroy);
+        void RunDeferred(bool all = false);
+
+        struct DeferredDestroy
+        {
+            uint64_t serial;
+            std::function<void()> destroy;
+        };
+        std::deque<DeferredDestroy> m_DeferredDestroys;
+        bool m_SwapchainDirty = false;
+
         SwapchainData m_vkSwapchainData{};
         std::vector<FrameData> m_vkFramesData{};
-        std::vector<vk::Semaphore> m_vkRecycleSemaphores{};
+        uint32_t m_FramesInFlight = s_DefaultFramesInFlight;
+        uint32_t m_FrameIndex = 0;
+
+        uint64_t m_SubmitSerial = 0;
+        uint64_t m_CompletedSerial = 0;
+
+        bool m_Vsync = false;
 
         friend class Window;
     };
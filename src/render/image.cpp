@@ -0,0 +1,72 @@
+#include "safpch.h"
+#include "image.h"
+
+#include "platform/vulkangraphics.h"
+#include "effects/imagebuffer.h"
+#include "globals.h"
+
+#include <vector>
+
+namespace saf {
+
+    Image::Image(const std::string& file)
+    {
+        ImageBuffer buffer;
+        if (!buffer.Load(file, 4)) IFX_ERROR("Failed to load image {0}", file);
+        Create(buffer);
+    }
+
+    Image::Image(const ImageBuffer& buffer)
+    {
+        Create(buffer);
+    }
+
+    Image::Image(uint32_t width, uint32_t height, const uint8_t* rgba)
+    {
+        Create(width, height, rgba);
+    }
+
+    Image::~Image()
+    {
+        if (m_vkImageView) global::g_Device.destroyImageView(m_vkImageView);
+        if (m_vkImage) global::g_Allocator.destroyImage(m_vkImage, m_vmaAllocation);
+    }
+
+    void Image::Create(const ImageBuffer& buffer)
+    {
+        if (buffer.GetChannels() == 4)
+        {
+            Create(buffer.GetWidth(), buffer.GetHeight(), buffer.GetData());
+            return;
+        }
+
+        // Gray, gray alpha and RGB are widened, three channel formats are rarely sampleable
+        const uint32_t channels = buffer.GetChannels();
+        std::vector<uint8_t> rgba(buffer.GetPixelCount() * 4);
+        const uint8_t* source = buffer.GetData();
+        for (uint64_t i = 0; i < buffer.GetPixelCount(); ++i, source += channels)
+        {
+            uint8_t* pixel = rgba.data() + i * 4;
+            switch (channels)
+            {
+            case 1: pixel[0] = pixel[1] = pixel[2] = source[0]; pixel[3] = 255; break;
+            case 2: pixel[0] = pixel[1] = pixel[2] = source[0]; pixel[3] = source[1]; break;
+            default: pixel[0] = source[0]; pixel[1] = source[1]; pixel[2] = source[2]; pixel[3] = 255; break;
+            }
+        }
+        Create(buffer.GetWidth(), buffer.GetHeight(), rgba.data());
+    }
+
+    void Image::Create(uint32_t width, uint32_t height, const uint8_t* rgba)
+    {
+        m_Width = width;
+        m_Height = height;
+
+        m_vkImage = vkhelper::CreateImage(global::g_Device, global::g_GraphicsQueueIndex, global::g_Allocator, width, height, 4, const_cast<uint8_t*>(rgba), m_vmaAllocation);
+
+        vk::ImageViewCreateInfo imageview_create_info({}, m_vkImage, vk::ImageViewType::e2D, vk::Format::eR8G8B8A8Unorm, {}, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+        m_vkImageView = global::g_Device.createImageView(imageview_create_info);
+        if (!m_vkImageView) IFX_ERROR("Vulkan failed to create image view");
+    }
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vk_mem_alloc.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include <string>
+
+namespace saf {
+
+    class ImageBuffer;
+
+    // RGBA8 texture for Renderer2D::DrawImage, uploaded once when it is created
+    class Image
+    {
+    public:
+        Image(const std::string& file);
+        Image(const ImageBuffer& buffer);
+        Image(uint32_t width, uint32_t height, const uint8_t* rgba);
+        Image(const Image&) = delete;
+        Image(Image&&) = delete;
+        Image& operator=(const Image&) = delete;
+        Image& operator=(Image&&) = delete;
+        ~Image();
+
+        inline vk::ImageView GetImageView() const { return m_vkImageView; }
+        inline uint32_t GetWidth() const { return m_Width; }
+        inline uint32_t GetHeight() const { return m_Height; }
+
+    private:
+        void Create(const ImageBuffer& buffer);
+        void Create(uint32_t width, uint32_t height, const uint8_t* rgba);
+
+        uint32_t m_Width = 0;
+        uint32_t m_Height = 0;
+
+        vk::Image m_vkImage = nullptr;
+        vk::ImageView m_vkImageView = nullptr;
+        vma::Allocation m_vmaAllocation = nullptr;
+    };
+
+}
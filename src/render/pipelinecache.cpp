@@ -0,0 +1,164 @@
+#include "safpch.h"
+#include "pipelinecache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "globals.h"
+#include "utils/hash.h"
+
+namespace saf {
+
+    static constexpr uint32_t s_PipelineCacheMagic = 0x43464153; // "SAFC"
+    static constexpr uint32_t s_PipelineCacheVersion = 1;
+
+    struct PipelineCacheFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint32_t driver_version;
+        uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+        uint64_t data_size;
+        uint64_t data_hash;
+    };
+
+    static PipelineCacheFileHeader MakeHeader(const vk::PhysicalDeviceProperties& properties)
+    {
+        PipelineCacheFileHeader header{};
+        header.magic = s_PipelineCacheMagic;
+        header.version = s_PipelineCacheVersion;
+        header.vendor_id = properties.vendorID;
+        header.device_id = properties.deviceID;
+        header.driver_version = properties.driverVersion;
+        std::memcpy(header.pipeline_cache_uuid, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+        return header;
+    }
+
+    PipelineCache::~PipelineCache()
+    {
+        Shutdown();
+    }
+
+    void PipelineCache::Init(const std::string& path)
+    {
+        m_Path = path;
+
+        std::vector<uint8_t> data = Load();
+
+        vk::PipelineCacheCreateInfo pipeline_cache_create_info({}, data.size(), data.empty() ? nullptr : data.data());
+        m_vkPipelineCache = global::g_Device.createPipelineCache(pipeline_cache_create_info);
+    }
+
+    void PipelineCache::Shutdown()
+    {
+        if (!m_vkPipelineCache) return;
+
+        LogStats("this run");
+        Save();
+
+        global::g_Device.destroyPipelineCache(m_vkPipelineCache);
+        m_vkPipelineCache = nullptr;
+    }
+
+    void PipelineCache::Record(const char* name, const vk::PipelineCreationFeedback& feedback)
+    {
+        if (!(feedback.flags & vk::PipelineCreationFeedbackFlagBits::eValid))
+        {
+            IFX_TRACE("PipelineCache {0}: driver gave no creation feedback", name);
+            return;
+        }
+
+        const bool hit = static_cast<bool>(feedback.flags & vk::PipelineCreationFeedbackFlagBits::eApplicationPipelineCacheHit);
+        if (hit) ++m_Hits;
+        else ++m_Misses;
+
+        IFX_INFO("PipelineCache {0}: {1} ({2:.2f} ms)", name, hit ? "hit" : "miss", static_cast<double>(feedback.duration) / 1e6);
+    }
+
+    void PipelineCache::LogStats(const char* when) const
+    {
+        IFX_INFO("PipelineCache {0} hits, {1} misses {2}", m_Hits.load(), m_Misses.load(), when);
+    }
+
+    std::vector<uint8_t> PipelineCache::Load() const
+    {
+        std::ifstream file(m_Path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            IFX_INFO("PipelineCache no cache at {0}, starting cold", m_Path);
+            return {};
+        }
+
+        const uint64_t file_size = static_cast<uint64_t>(file.tellg());
+        file.seekg(0);
+
+        PipelineCacheFileHeader header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        const PipelineCacheFileHeader expected = MakeHeader(global::g_PhysicalDevice.getProperties());
+        if (!file || file_size < sizeof(header) || header.magic != expected.magic || header.version != expected.version)
+        {
+            IFX_WARN("PipelineCache {0} is not a pipeline cache file, ignoring it", m_Path);
+            return {};
+        }
+
+        if (header.vendor_id != expected.vendor_id || header.device_id != expected.device_id || header.driver_version != expected.driver_version ||
+            std::memcmp(header.pipeline_cache_uuid, expected.pipeline_cache_uuid, VK_UUID_SIZE) != 0)
+        {
+            IFX_INFO("PipelineCache {0} was written by another device or driver, starting cold", m_Path);
+            return {};
+        }
+
+        // Check the size before allocating, a damaged header must not turn into a huge allocation
+        if (header.data_size > file_size - sizeof(header))
+        {
+            IFX_WARN("PipelineCache {0} claims {1} bytes but only has {2}, starting cold", m_Path, header.data_size, file_size - sizeof(header));
+            return {};
+        }
+
+        std::vector<uint8_t> data(header.data_size);
+        file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file || Fnv1a64(data.data(), data.size()) != header.data_hash)
+        {
+            IFX_WARN("PipelineCache {0} is truncated or corrupt, starting cold", m_Path);
+            return {};
+        }
+
+        IFX_INFO("PipelineCache loaded {0} bytes from {1}", data.size(), m_Path);
+        return data;
+    }
+
+    void PipelineCache::Save() const
+    {
+        std::vector<uint8_t> data = global::g_Device.getPipelineCacheData(m_vkPipelineCache);
+
+        PipelineCacheFileHeader header = MakeHeader(global::g_PhysicalDevice.getProperties());
+        header.data_size = data.size();
+        header.data_hash = Fnv1a64(data.data(), data.size());
+
+        std::error_code error;
+        const std::filesystem::path path(m_Path);
+        if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), error);
+
+        // Write next to the target and rename over it, a crash mid write never leaves a half written cache behind
+        const std::string temp = m_Path + ".tmp";
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            if (!file)
+            {
+                IFX_WARN("PipelineCache failed to write {0}", temp);
+                return;
+            }
+        }
+
+        std::filesystem::rename(temp, m_Path, error);
+        if (error) IFX_WARN("PipelineCache failed to replace {0}: {1}", m_Path, error.message());
+        else IFX_INFO("PipelineCache saved {0} bytes to {1}", data.size(), m_Path);
+    }
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <atomic>
+#include <string>
+
+namespace saf {
+
+    /*
+    vk::PipelineCache persisted to disk between runs.
+
+    The file starts with our own header (vendor, device, driver version, pipeline cache UUID and a hash of the blob),
+    anything that does not match the current device is discarded and the cache starts empty.
+    Every pipeline creation should pass Get() and hand its creation feedback to Record() so hits and misses get reported.
+    */
+    class PipelineCache
+    {
+    public:
+        PipelineCache() = default;
+        PipelineCache(const PipelineCache&) = delete;
+        PipelineCache(PipelineCache&&) = delete;
+        PipelineCache& operator=(const PipelineCache&) = delete;
+        PipelineCache& operator=(PipelineCache&&) = delete;
+        ~PipelineCache();
+
+        void Init(const std::string& path);
+        void Shutdown();
+
+        inline vk::PipelineCache Get() const { return m_vkPipelineCache; }
+
+        void Record(const char* name, const vk::PipelineCreationFeedback& feedback);
+
+        // Hits and misses recorded so far, call once the startup pipelines exist to see whether the cache was warm
+        void LogStats(const char* when) const;
+
+    private:
+        std::vector<uint8_t> Load() const;
+        void Save() const;
+
+        std::string m_Path;
+        vk::PipelineCache m_vkPipelineCache = nullptr;
+
+        std::atomic<uint32_t> m_Hits{ 0 };
+        std::atomic<uint32_t> m_Misses{ 0 };
+    };
+
+}
@@ -1,15 +1,18 @@
 #include "safpch.h"
 #include "renderer2d.h"
 
-#include <stb_truetype.h>
-#include <stb_image_write.h>
-#include <fstream>
 #include "platform/vulkangraphics.h"
 
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/constants.hpp>
 
 #include "globals.h"
+#include "utils/hash.h"
+#include "utils/benchmark.h"
+#include "utils/radixsort.h"
 #include <string>
+#include <cstring>
 
 namespace saf {
 
@@ -44,153 +47,48 @@ namespace saf {
         scale = _scale;
     }
 
-    FontAtlas::FontAtlas(std::vector<std::string> files, int width, int height, int firstCode, int numofchars)
-        : m_FirstCode(firstCode), m_NumOfCodes(numofchars), m_Width(width), m_Height(height)
-	{
-        int number_of_fonts = files.size();
-        m_NumOfFonts = number_of_fonts;
-
-        m_PackedChars = new stbtt_packedchar[m_NumOfCodes * number_of_fonts];
-        m_AlignedQuads = new stbtt_aligned_quad[m_NumOfCodes * number_of_fonts];
-        m_RawData = new uint8_t[m_Width * m_Height * number_of_fonts];
-
-        // Read the font file
-
-        for (int n = 0; n < number_of_fonts; ++n)
-        {
-            std::string file = files[n];
-            std::ifstream inputStream(file.c_str(), std::ios::binary);
-
-            inputStream.seekg(0, std::ios::end);
-            auto&& fontFileSize = inputStream.tellg();
-            inputStream.seekg(0, std::ios::beg);
-
-            uint8_t* fontDataBuf = new uint8_t[fontFileSize];
-            inputStream.read((char*)fontDataBuf, fontFileSize);
-
-            stbtt_fontinfo fontInfo = {};
-
-            uint32_t fontCount = stbtt_GetNumberOfFonts(fontDataBuf);
-            IFX_TRACE("Font file: {0} contains {1} fonts", files[n], fontCount);
-
-            if (!stbtt_InitFont(&fontInfo, fontDataBuf, 0))
-                std::cerr << "stbtt_InitFont() Failed!\n";
-
-            stbtt_pack_context ctx{};
-
-           uint8_t* pPixelData = &m_RawData[n * m_Width * m_Height];
-           stbtt_packedchar* pChardata = &m_PackedChars[n * m_NumOfCodes];
-
-            stbtt_PackBegin(
-                &ctx,                                     // stbtt_pack_context (this call will initialize it) 
-                static_cast<unsigned char*>(pPixelData),                // Font Atlas texture data
-                m_Width,                                  // Width of the font atlas texture
-                m_Height,                                 // Height of the font atlas texture
-                0,                                        // Stride in bytes
-                1,                                        // Padding between the glyphs
-                nullptr);
-
-            stbtt_PackFontRange(
-                &ctx,                                     // stbtt_pack_context
-                fontDataBuf,                              // Font Atlas texture data
-                0,                         // Font Index                                 
-                64.f,                                     // Size of font in pixels. (Use STBTT_POINT_SIZE(fontSize) to use points) 
-                firstCode,                                // Code point of the first charecter
-                m_NumOfCodes,                             // No. of charecters to be included in the font atlas 
-                pChardata                             // stbtt_packedchar array, this struct will contain the data to render a glyph
-            );
-
-            stbtt_PackEnd(&ctx);
-
-            for (int i = 0; i < m_NumOfCodes; ++i)
-            {
-                float unusedX, unusedY;
-
-                stbtt_GetPackedQuad(
-                    pChardata,              // Array of stbtt_packedchar
-                    m_Width,                           // Width of the font atlas texture
-                    m_Height,                          // Height of the font atlas texture
-                    i,                                 // Index of the glyph
-                    &unusedX, &unusedY,                // current position of the glyph in screen pixel coordinates, (not required as we have a different corrdinate system)
-                    &(m_AlignedQuads[i + n * m_NumOfCodes]),              // stbtt_alligned_quad struct. (this struct mainly consists of the texture coordinates)
-                    0                                  // Allign X and Y position to a integer (doesn't matter because we are not using 'unusedX' and 'unusedY')
-                );
-            }
-
-            delete[] fontDataBuf;
+    // Layouts unused for this many frames are dropped, at most s_LayoutCacheCapacity are kept
+    static constexpr uint64_t s_LayoutCacheMaxAge = 120;
+    static constexpr size_t s_LayoutCacheCapacity = 4096;
 
-            stbi_write_png((std::string("fontAtlas") + std::to_string(n) + ".png").c_str(), m_Width, m_Height, 1, pPixelData, m_Width);
-        }
-
-        // Optionally write the font atlas texture as a png file.
-
-        m_vkFontAtlas = vkhelper::CreateImage3D(global::g_Device, global::g_GraphicsQueueIndex, global::g_Allocator, m_Width, m_Height, number_of_fonts, 1, m_RawData, m_vmaFontAtlasAllocation);
-
-        vk::ImageViewCreateInfo imageview_create_info({}, m_vkFontAtlas, vk::ImageViewType::e3D, vk::Format::eR8Unorm, {}, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
-        m_vkFontAtlasView = global::g_Device.createImageView(imageview_create_info);
-
-        Free();
-	}
-
-    void FontAtlas::Shutdown()
-    {
-        if (m_vkFontAtlasView) global::g_Device.destroyImageView(m_vkFontAtlasView);
-        if (m_vkFontAtlas) global::g_Allocator.destroyImage(m_vkFontAtlas, m_vmaFontAtlasAllocation);
-    }
-
-    FontAtlas::~FontAtlas()
-    {
-        Free();
-        delete[] m_PackedChars;
-        delete[] m_AlignedQuads;
-    }
-
-    Renderer2D::Renderer2D()
+    Renderer2D::Renderer2D(GlyphMode glyph_mode)
+        : m_GlyphMode(glyph_mode)
     {
 
     }
 
 	void Renderer2D::Init()
 	{
-        m_vkVertexBuffer = vkhelper::create_buffer(sizeof(Vertex) * m_MaxQuads * 4, vk::BufferUsageFlagBits::eVertexBuffer, vk::SharingMode::eExclusive, vma::MemoryUsage::eAutoPreferHost, vma::AllocationCreateFlagBits::eHostAccessSequentialWrite, global::g_Allocator, m_vmaVertexAllocation);
-        if (global::g_Allocator.mapMemory(m_vmaVertexAllocation, reinterpret_cast<void**>(&m_VertexBuffer)) != vk::Result::eSuccess)
-            IFX_ERROR("Failed to map vertex buffer");
-
-        m_vkBasicVertexBuffer = vkhelper::create_buffer(sizeof(Vertex) * m_MaxQuads * 4, vk::BufferUsageFlagBits::eVertexBuffer, vk::SharingMode::eExclusive, vma::MemoryUsage::eAutoPreferHost, vma::AllocationCreateFlagBits::eHostAccessSequentialWrite, global::g_Allocator, m_vmaBasicVertexAllocation);
-        if (global::g_Allocator.mapMemory(m_vmaBasicVertexAllocation, reinterpret_cast<void**>(&m_BasicVertexBuffer)) != vk::Result::eSuccess)
-            IFX_ERROR("Failed to map vertex buffer");
-
-        uint32_t indices[6]
+        // Shader modules (a full GLSL compile with SAF_RUNTIME_SHADERC) do not depend on anything below, create them on the job system while the buffers and glyph cache are built
+        std::array<std::string, 6> shader_files
         {
-            0, 1, 2, 0, 2, 3
+            "assets/shaders/fonts.vert",
+            m_GlyphMode == GlyphMode::SDF ? "assets/shaders/fonts_sdf.frag" : "assets/shaders/fonts.frag",
+            "assets/shaders/quad.vert",
+            "assets/shaders/quad.frag",
+            "assets/shaders/image.vert",
+            "assets/shaders/image.frag"
         };
+        std::array<vk::ShaderModule, 6> shader_modules{};
 
-        vma::Allocation allocation;
-        vk::Buffer stage_buffer = vkhelper::create_buffer(sizeof(uint32_t) * m_MaxQuads * 6, vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eIndexBuffer, vk::SharingMode::eExclusive, vma::MemoryUsage::eAutoPreferHost, vma::AllocationCreateFlagBits::eHostAccessSequentialWrite, global::g_Allocator, allocation);
-        uint32_t* data;
-        if (global::g_Allocator.mapMemory(allocation, reinterpret_cast<void**>(&data)) != vk::Result::eSuccess)
-            IFX_ERROR("Failed to map index staging buffer");
-
-        for (int i = 0; i < m_MaxQuads; ++i)
+        JobCounter shader_counter;
+        for (size_t i = 0; i < shader_files.size(); ++i)
         {
-            data[i * 6 + 0] = indices[0] + i * 4;
-            data[i * 6 + 1] = indices[1] + i * 4;
-            data[i * 6 + 2] = indices[2] + i * 4;
-            data[i * 6 + 3] = indices[3] + i * 4;
-            data[i * 6 + 4] = indices[4] + i * 4;
-            data[i * 6 + 5] = indices[5] + i * 4;
+            global::g_JobSystem->Run([&shader_files, &shader_modules, i]() { shader_modules[i] = vkhelper::CreateShaderModule(global::g_Device, shader_files[i]); }, &shader_counter);
         }
-        global::g_Allocator.unmapMemory(allocation);
-
-        m_vkIndexBuffer = vkhelper::create_buffer(sizeof(uint32_t) * m_MaxQuads * 6, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::SharingMode::eExclusive, vma::MemoryUsage::eAutoPreferDevice, vma::AllocationCreateFlagBits::eDedicatedMemory, global::g_Allocator, m_vmaIndexAllocation);
 
-        saf::vkhelper::immediate_submit(global::g_Device, global::g_GraphicsQueueIndex, [&stage_buffer, this](vk::CommandBuffer cmd)
-            {
-                vk::BufferCopy buffer_copy(0, 0, m_MaxQuads * 6 * sizeof(uint32_t));
-                cmd.copyBuffer(stage_buffer, m_vkIndexBuffer, buffer_copy);
-            });
+        // One record per quad, the shaders expand the corners so there is no index buffer.
+        // Every region has its own chunks, the CPU fills one region while the GPU reads the others.
+        m_vmaInstancePool = vkhelper::CreateBufferPool(sizeof(GlyphInstance) * InstanceBatch<GlyphInstance>::s_ChunkSize, vk::BufferUsageFlagBits::eVertexBuffer, vma::MemoryUsage::eAutoPreferHost, vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped, s_InstancePoolBlockSize, global::g_Allocator);
+        for (uint32_t region = 0; region < s_InstanceRegions; ++region)
+        {
+            m_GlyphBatches[region].Init(m_vmaInstancePool);
+            m_RectBatches[region].Init(m_vmaInstancePool);
+            m_ImageBatches[region].Init(m_vmaInstancePool);
+        }
 
-        global::g_Allocator.destroyBuffer(stage_buffer, allocation);
+        m_Region = 0;
+        m_RegionSerials.fill(0);
 
         {
             std::vector<std::string> files
@@ -202,7 +100,7 @@ namespace saf {
                 "C:/Windows/Fonts/impact.ttf",
                 "assets/chiller.ttf"
             };
-            m_FontAtlas = std::make_shared<FontAtlas>(files, 512, 512, 32, 96);
+            m_GlyphCache = std::make_shared<GlyphCache>(files, 64.f, m_GlyphMode, m_GlyphMode == GlyphMode::SDF ? "cache/glyphs_sdf.bin" : "cache/glyphs_bitmap.bin");
 
             vk::DescriptorSetLayoutBinding desc_layout_binding{};
             desc_layout_binding.binding = 0;
@@ -220,39 +118,42 @@ namespace saf {
             desc_alloc_info.pSetLayouts = &m_vkAtlasDescriptorSetLayout;
 
             m_vkAtlasDescriptorSet = global::g_Device.allocateDescriptorSets(desc_alloc_info)[0];
-            m_vkAtlasSampler = vkhelper::CreateFontSampler(global::g_Device);
+            m_vkAtlasSampler = vkhelper::CreateFontSampler(global::g_Device, m_GlyphMode == GlyphMode::SDF ? vk::Filter::eLinear : vk::Filter::eNearest);
 
             vk::DescriptorImageInfo desc_image_info;
             desc_image_info.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-            desc_image_info.imageView = m_FontAtlas->m_vkFontAtlasView;
+            desc_image_info.imageView = m_GlyphCache->GetImageView();
             desc_image_info.sampler = m_vkAtlasSampler;
 
             vk::WriteDescriptorSet desc_set_write(m_vkAtlasDescriptorSet, desc_layout_binding.binding, 0, vk::DescriptorType::eCombinedImageSampler, desc_image_info);
             global::g_Device.updateDescriptorSets(desc_set_write, {});
+            m_vkBoundGlyphView = desc_image_info.imageView;
 
             vk::PushConstantRange pushconstant_range(vk::ShaderStageFlagBits::eVertex, 0, sizeof(Uniform));
 
             vk::PipelineLayoutCreateInfo pipeline_layout_info({}, m_vkAtlasDescriptorSetLayout, pushconstant_range);
             m_vkAtlasPipelineLayout = global::g_Device.createPipelineLayout({ pipeline_layout_info });
 
+            global::g_JobSystem->Wait(shader_counter);
+
             std::vector<vk::PipelineShaderStageCreateInfo> shader_stages
             {
                 vk::PipelineShaderStageCreateInfo(
                     {},
                     vk::ShaderStageFlagBits::eVertex,
-                    vkhelper::CreateShaderModule(global::g_Device, "assets/shaders/fonts.vert"),
+                    shader_modules[0],
                     "main"
                 ),
                 vk::PipelineShaderStageCreateInfo(
                     {},
                     vk::ShaderStageFlagBits::eFragment,
-                    vkhelper::CreateShaderModule(global::g_Device, "assets/shaders/fonts.frag"),
+                    shader_modules[1],
                     "main"
                 )
             };
 
-            auto vertex_input_binding_descs = Vertex::getBindingDescription();
-            auto vertex_input_attrib_descs = Vertex::getAttributeDescription();
+            auto vertex_input_binding_descs = GlyphInstance::getBindingDescription();
+            auto vertex_input_attrib_descs = GlyphInstance::getAttributeDescription();
 
             vk::PipelineVertexInputStateCreateInfo vertex_input({}, vertex_input_binding_descs, vertex_input_attrib_descs);
 
@@ -274,9 +175,10 @@ namespace saf {
             // Disable all depth testing.
             vk::PipelineDepthStencilStateCreateInfo depth_stencil;
 
+            vk::PipelineCreationFeedback feedback;
             m_vkAtlasPipeline = vkhelper::CreateGraphicsPipeline(
                 global::g_Device,
-                nullptr,
+                global::g_PipelineCache->Get(),
                 shader_stages,
                 vertex_input,
                 vk::PrimitiveTopology::eTriangleList,        // We will use triangle lists to draw geometry.
@@ -287,8 +189,10 @@ namespace saf {
                 { blend_attachment },
                 depth_stencil,
                 m_vkAtlasPipelineLayout,
-                global::g_SurfaceFormat.format
+                global::g_SurfaceFormat.format,
+                &feedback
             ); // We need to specify the pipeline layout
+            global::g_PipelineCache->Record("atlas", feedback);
 
             if (!m_vkAtlasPipeline) IFX_ERROR("Vulkan failed to create atlas graphics pipeline");
             // Pipeline is baked, we can delete the shader modules now.
@@ -308,19 +212,19 @@ namespace saf {
                 vk::PipelineShaderStageCreateInfo(
                     {},
                     vk::ShaderStageFlagBits::eVertex,
-                    vkhelper::CreateShaderModule(global::g_Device, "assets/shaders/quad.vert"),
+                    shader_modules[2],
                     "main"
                 ),
                 vk::PipelineShaderStageCreateInfo(
                     {},
                     vk::ShaderStageFlagBits::eFragment,
-                    vkhelper::CreateShaderModule(global::g_Device, "assets/shaders/quad.frag"),
+                    shader_modules[3],
                     "main"
                 )
             };
 
-            auto vertex_input_binding_descs = BasicVertex::getBindingDescription();
-            auto vertex_input_attrib_descs = BasicVertex::getAttributeDescription();
+            auto vertex_input_binding_descs = RectInstance::getBindingDescription();
+            auto vertex_input_attrib_descs = RectInstance::getAttributeDescription();
 
             vk::PipelineVertexInputStateCreateInfo vertex_input({}, vertex_input_binding_descs, vertex_input_attrib_descs);
 
@@ -342,9 +246,10 @@ namespace saf {
             // Disable all depth testing.
             vk::PipelineDepthStencilStateCreateInfo depth_stencil;
 
+            vk::PipelineCreationFeedback feedback;
             m_vkQuadPipeline = vkhelper::CreateGraphicsPipeline(
                 global::g_Device,
-                nullptr,
+                global::g_PipelineCache->Get(),
                 shader_stages,
                 vertex_input,
                 vk::PrimitiveTopology::eTriangleList,        // We will use triangle lists to draw geometry.
@@ -355,14 +260,101 @@ namespace saf {
                 { blend_attachment },
                 depth_stencil,
                 m_vkQuadPipelineLayout,
-                global::g_SurfaceFormat.format
+                global::g_SurfaceFormat.format,
+                &feedback
             ); // We need to specify the pipeline layout
+            global::g_PipelineCache->Record("quad", feedback);
 
             if (!m_vkQuadPipeline) IFX_ERROR("Vulkan failed to create basic graphics pipeline");
             // Pipeline is baked, we can delete the shader modules now.
             global::g_Device.destroyShaderModule(shader_stages[0].module);
             global::g_Device.destroyShaderModule(shader_stages[1].module);
         }
+
+        {
+            // One array of s_MaxImages images, slots are written as images are first drawn, also while earlier frames are in flight
+            vk::DescriptorPoolSize pool_size(vk::DescriptorType::eCombinedImageSampler, s_MaxImages);
+            vk::DescriptorPoolCreateInfo pool_create_info(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind, 1, pool_size);
+            m_vkImageDescriptorPool = global::g_Device.createDescriptorPool(pool_create_info);
+
+            vk::DescriptorSetLayoutBinding desc_layout_binding(0, vk::DescriptorType::eCombinedImageSampler, s_MaxImages, vk::ShaderStageFlagBits::eFragment);
+            vk::DescriptorBindingFlags binding_flags = vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+            vk::DescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info(binding_flags);
+
+            vk::DescriptorSetLayoutCreateInfo desc_layout_info(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, desc_layout_binding);
+            desc_layout_info.pNext = &binding_flags_info;
+            m_vkImageDescriptorSetLayout = global::g_Device.createDescriptorSetLayout(desc_layout_info);
+
+            vk::DescriptorSetAllocateInfo desc_alloc_info(m_vkImageDescriptorPool, m_vkImageDescriptorSetLayout);
+            m_vkImageDescriptorSet = global::g_Device.allocateDescriptorSets(desc_alloc_info)[0];
+            m_vkImageSampler = vkhelper::CreateImageSampler(global::g_Device);
+
+            vk::PushConstantRange pushconstant_range(vk::ShaderStageFlagBits::eVertex, 0, sizeof(Uniform));
+
+            vk::PipelineLayoutCreateInfo pipeline_layout_info({}, m_vkImageDescriptorSetLayout, pushconstant_range);
+            m_vkImagePipelineLayout = global::g_Device.createPipelineLayout({ pipeline_layout_info });
+
+            std::vector<vk::PipelineShaderStageCreateInfo> shader_stages
+            {
+                vk::PipelineShaderStageCreateInfo(
+                    {},
+                    vk::ShaderStageFlagBits::eVertex,
+                    shader_modules[4],
+                    "main"
+                ),
+                vk::PipelineShaderStageCreateInfo(
+                    {},
+                    vk::ShaderStageFlagBits::eFragment,
+                    shader_modules[5],
+                    "main"
+                )
+            };
+
+            auto vertex_input_binding_descs = ImageInstance::getBindingDescription();
+            auto vertex_input_attrib_descs = ImageInstance::getAttributeDescription();
+
+            vk::PipelineVertexInputStateCreateInfo vertex_input({}, vertex_input_binding_descs, vertex_input_attrib_descs);
+
+            vk::PipelineColorBlendAttachmentState blend_attachment(
+                vk::True,
+                vk::BlendFactor::eSrcAlpha,              // src factor
+                vk::BlendFactor::eOneMinusSrcAlpha,      // dst factor
+                vk::BlendOp::eAdd,                  // color blend op
+                vk::BlendFactor::eOne,              // src alpha factor
+                vk::BlendFactor::eOne,              // dst alpha factor
+                vk::BlendOp::eAdd,                  // alpha blend op
+                vk::ColorComponentFlagBits::eR |    // blend mask
+                vk::ColorComponentFlagBits::eG |
+                vk::ColorComponentFlagBits::eB |
+                vk::ColorComponentFlagBits::eA
+            );
+
+            // Disable all depth testing.
+            vk::PipelineDepthStencilStateCreateInfo depth_stencil;
+
+            vk::PipelineCreationFeedback feedback;
+            m_vkImagePipeline = vkhelper::CreateGraphicsPipeline(
+                global::g_Device,
+                global::g_PipelineCache->Get(),
+                shader_stages,
+                vertex_input,
+                vk::PrimitiveTopology::eTriangleList,
+                0,
+                vk::PolygonMode::eFill,
+                vk::CullModeFlagBits::eBack,
+                vk::FrontFace::eClockwise,
+                { blend_attachment },
+                depth_stencil,
+                m_vkImagePipelineLayout,
+                global::g_SurfaceFormat.format,
+                &feedback
+            );
+            global::g_PipelineCache->Record("image", feedback);
+
+            if (!m_vkImagePipeline) IFX_ERROR("Vulkan failed to create image graphics pipeline");
+            global::g_Device.destroyShaderModule(shader_stages[0].module);
+            global::g_Device.destroyShaderModule(shader_stages[1].module);
+        }
 	}
 
     void Renderer2D::Shutdown()
@@ -372,19 +364,13 @@ namespace saf {
         if (m_vkAtlasDescriptorSetLayout) global::g_Device.destroyDescriptorSetLayout(m_vkAtlasDescriptorSetLayout);
         if (m_vkAtlasDescriptorSet) global::g_Device.freeDescriptorSets(global::g_DescriptorPool, { m_vkAtlasDescriptorSet });
 
-        if (m_vkVertexBuffer)
-        {
-            global::g_Allocator.unmapMemory(m_vmaVertexAllocation);
-            global::g_Allocator.destroyBuffer(m_vkVertexBuffer, m_vmaVertexAllocation);
-        }
-        if (m_vkBasicVertexBuffer)
-        {
-            global::g_Allocator.unmapMemory(m_vmaBasicVertexAllocation);
-            global::g_Allocator.destroyBuffer(m_vkBasicVertexBuffer, m_vmaBasicVertexAllocation);
-        }
-        if (m_vkIndexBuffer) global::g_Allocator.destroyBuffer(m_vkIndexBuffer, m_vmaIndexAllocation);
+        for (auto& batch : m_GlyphBatches) batch.Destroy();
+        for (auto& batch : m_RectBatches) batch.Destroy();
+        for (auto& batch : m_ImageBatches) batch.Destroy();
+        if (m_vmaInstancePool) global::g_Allocator.destroyPool(m_vmaInstancePool);
+        m_vmaInstancePool = nullptr;
 
-        if (m_FontAtlas) m_FontAtlas->Shutdown();
+        if (m_GlyphCache) m_GlyphCache->Shutdown();
         if (m_vkAtlasSampler) global::g_Device.destroySampler(m_vkAtlasSampler);
 
         if (m_vkAtlasPipeline) global::g_Device.destroy(m_vkAtlasPipeline);
@@ -392,6 +378,17 @@ namespace saf {
 
         if (m_vkQuadPipeline) global::g_Device.destroy(m_vkQuadPipeline);
         if (m_vkQuadPipelineLayout) global::g_Device.destroyPipelineLayout(m_vkQuadPipelineLayout);
+
+        if (m_vkImagePipeline) global::g_Device.destroy(m_vkImagePipeline);
+        if (m_vkImagePipelineLayout) global::g_Device.destroyPipelineLayout(m_vkImagePipelineLayout);
+        if (m_vkImageDescriptorSetLayout) global::g_Device.destroyDescriptorSetLayout(m_vkImageDescriptorSetLayout);
+        if (m_vkImageDescriptorPool) global::g_Device.destroyDescriptorPool(m_vkImageDescriptorPool);
+        if (m_vkImageSampler) global::g_Device.destroySampler(m_vkImageSampler);
+
+        m_ImageSlots.clear();
+        m_ImageSlotIndices.clear();
+        m_FreeImageSlots.clear();
+        m_PendingImageReleases.clear();
     }
 
 	void Renderer2D::BeginScene()
@@ -404,44 +401,553 @@ namespace saf {
         
 	}
 
+    void Renderer2D::Upload(vk::CommandBuffer cmd, uint32_t frame, const GlyphCache::DeferFn& defer)
+    {
+        m_GlyphCache->Upload(cmd, frame, defer);
+        ReleaseImageSlots();
+
+        // Drop layouts no label has drawn for a while
+        ++m_Frame;
+        if (m_Frame % s_LayoutCacheMaxAge == 0)
+        {
+            for (auto it = m_LayoutCache.begin(); it != m_LayoutCache.end();)
+            {
+                if (it->second.last_used + s_LayoutCacheMaxAge < m_Frame) it = m_LayoutCache.erase(it);
+                else ++it;
+            }
+        }
+        m_LayoutStats.entries = m_LayoutCache.size();
+
+        // Frames in flight still draw with the old set and the old pages, the grown image goes into a new set
+        // and the old one is freed together with the old image once those frames are done
+        if (m_GlyphCache->GetImageView() != m_vkBoundGlyphView)
+        {
+            vk::DescriptorSetAllocateInfo desc_alloc_info(global::g_DescriptorPool, m_vkAtlasDescriptorSetLayout);
+            vk::DescriptorSet desc_set = global::g_Device.allocateDescriptorSets(desc_alloc_info)[0];
+
+            vk::DescriptorImageInfo desc_image_info(m_vkAtlasSampler, m_GlyphCache->GetImageView(), vk::ImageLayout::eShaderReadOnlyOptimal);
+            vk::WriteDescriptorSet desc_set_write(desc_set, 0, 0, vk::DescriptorType::eCombinedImageSampler, desc_image_info);
+            global::g_Device.updateDescriptorSets(desc_set_write, {});
+
+            defer([old_set = m_vkAtlasDescriptorSet]() { global::g_Device.freeDescriptorSets(global::g_DescriptorPool, old_set); });
+            m_vkAtlasDescriptorSet = desc_set;
+            m_vkBoundGlyphView = desc_image_info.imageView;
+        }
+    }
+
+    template<typename T>
+    void InstanceBatch<T>::Init(vma::Pool pool)
+    {
+        m_vmaPool = pool;
+        m_Count = 0;
+    }
+
+    template<typename T>
+    void InstanceBatch<T>::Destroy()
+    {
+        for (auto& chunk : m_Chunks) global::g_Allocator.destroyBuffer(chunk.buffer, chunk.allocation);
+        m_Chunks.clear();
+        m_Staging = {};
+        m_Count = 0;
+        m_Committed = 0;
+    }
+
+    template<typename T>
+    T* InstanceBatch<T>::Reserve(uint32_t count)
+    {
+        // Grown geometrically and never shrunk, after the first frames this is a bump allocation
+        if (m_Count + count > m_Staging.size()) m_Staging.resize(std::max<size_t>(m_Staging.size() * 2, m_Count + count));
+
+        T* instances = m_Staging.data() + m_Count;
+        m_Count += count;
+        return instances;
+    }
+
+    template<typename T>
+    uint32_t InstanceBatch<T>::Commit()
+    {
+        while (m_Committed < m_Count)
+        {
+            const uint32_t chunk = m_Committed / s_ChunkSize;
+            if (chunk == m_Chunks.size())
+            {
+                Chunk& added = m_Chunks.emplace_back();
+                void* mapped = nullptr;
+                added.buffer = vkhelper::CreateMappedBuffer(sizeof(T) * s_ChunkSize, vk::BufferUsageFlagBits::eVertexBuffer, m_vmaPool, global::g_Allocator, added.allocation, mapped);
+                if (!added.buffer)
+                {
+                    m_Chunks.pop_back();
+                    break;
+                }
+                added.instances = static_cast<T*>(mapped);
+            }
+
+            // Whole instances front to back, the write combining buffers only ever see full sequential lines
+            const uint32_t offset = m_Committed % s_ChunkSize;
+            const uint32_t copied = std::min(m_Count - m_Committed, s_ChunkSize - offset);
+            std::memcpy(m_Chunks[chunk].instances + offset, m_Staging.data() + m_Committed, copied * sizeof(T));
+            m_Committed += copied;
+        }
+
+        return m_Committed;
+    }
+
+    template<typename T>
+    void InstanceBatch<T>::Draw(vk::CommandBuffer cmd, uint32_t first, uint32_t count, vk::Buffer& bound, FrameStats& stats) const
+    {
+        count = first < m_Committed ? std::min(count, m_Committed - first) : 0;
+        while (count > 0)
+        {
+            const Chunk& chunk = m_Chunks[first / s_ChunkSize];
+            const uint32_t offset = first % s_ChunkSize;
+            const uint32_t drawn = std::min(count, s_ChunkSize - offset);
+
+            if (bound != chunk.buffer)
+            {
+                cmd.bindVertexBuffers(0, chunk.buffer, { 0UL });
+                bound = chunk.buffer;
+                ++stats.buffer_binds;
+            }
+
+            // Six vertices per instance, the vertex shader picks the corner from gl_VertexIndex
+            cmd.draw(6, drawn, 0, offset);
+            ++stats.draw_calls;
+
+            first += drawn;
+            count -= drawn;
+        }
+    }
+
+    template class InstanceBatch<GlyphInstance>;
+    template class InstanceBatch<RectInstance>;
+    template class InstanceBatch<ImageInstance>;
+
+    void BenchmarkInstanceStaging(uint32_t instances, uint32_t frames)
+    {
+        const vk::DeviceSize size = static_cast<vk::DeviceSize>(instances) * sizeof(GlyphInstance);
+        vma::Pool pool = vkhelper::CreateBufferPool(sizeof(GlyphInstance) * InstanceBatch<GlyphInstance>::s_ChunkSize, vk::BufferUsageFlagBits::eVertexBuffer, vma::MemoryUsage::eAutoPreferHost, vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped, 0, global::g_Allocator);
+
+        vma::Allocation allocation = nullptr;
+        void* mapped = nullptr;
+        vk::Buffer buffer = vkhelper::CreateMappedBuffer(size, vk::BufferUsageFlagBits::eVertexBuffer, pool, global::g_Allocator, allocation, mapped);
+        if (!buffer) IFX_ERROR("-instancebench could not allocate {0} bytes of instance memory", size);
+
+        std::vector<GlyphInstance> source(instances);
+        for (uint32_t i = 0; i < instances; ++i)
+            source[i] = GlyphInstance::Pack(glm::vec2(static_cast<float>(i % 160) * 12.f, static_cast<float>(i / 160) * 16.f), glm::vec2(12.f, 16.f), glm::vec4(0.f, 0.f, 0.05f, 0.05f), glm::vec4(1.f), 0.f, i % 4);
+        const glm::vec2 center_offset(-40.f, -8.f);
+
+        BenchmarkTimer timer(frames, instances);
+
+        IFX_INFO("Instance emission, {0} glyph instances per frame over {1} frames", instances, frames);
+
+        // The old pattern: one pass per field straight into the mapping, then a DrawStringCenter style read back and move
+        GlyphInstance* direct = static_cast<GlyphInstance*>(mapped);
+        timer.Start();
+        for (uint32_t frame = 0; frame < frames; ++frame)
+        {
+            for (uint32_t i = 0; i < instances; ++i) direct[i].center = source[i].center;
+            for (uint32_t i = 0; i < instances; ++i) direct[i].size = source[i].size;
+            for (uint32_t i = 0; i < instances; ++i) { direct[i].uv[0] = source[i].uv[0]; direct[i].uv[1] = source[i].uv[1]; }
+            for (uint32_t i = 0; i < instances; ++i) direct[i].color = source[i].color;
+            for (uint32_t i = 0; i < instances; ++i) { direct[i].rotation = source[i].rotation; direct[i].layer = source[i].layer; direct[i].padding = 0; }
+            for (uint32_t i = 0; i < instances; ++i) direct[i].center += center_offset;
+        }
+        timer.Stop();
+        timer.Report("mapped, field by field", "instance", sizeof(GlyphInstance));
+
+        // The same writes into the staging arena, then one sequential copy into the chunks
+        InstanceBatch<GlyphInstance> batch;
+        batch.Init(pool);
+        timer.Start();
+        for (uint32_t frame = 0; frame < frames; ++frame)
+        {
+            GlyphInstance* staged = batch.Reserve(instances);
+            for (uint32_t i = 0; i < instances; ++i) staged[i].center = source[i].center;
+            for (uint32_t i = 0; i < instances; ++i) staged[i].size = source[i].size;
+            for (uint32_t i = 0; i < instances; ++i) { staged[i].uv[0] = source[i].uv[0]; staged[i].uv[1] = source[i].uv[1]; }
+            for (uint32_t i = 0; i < instances; ++i) staged[i].color = source[i].color;
+            for (uint32_t i = 0; i < instances; ++i) { staged[i].rotation = source[i].rotation; staged[i].layer = source[i].layer; staged[i].padding = 0; }
+            for (uint32_t i = 0; i < instances; ++i) batch[i].center += center_offset;
+
+            if (batch.Commit() != instances) IFX_ERROR("-instancebench could not allocate instance chunks");
+            batch.Clear();
+        }
+        timer.Stop();
+        timer.Report("staged, one copy", "instance", sizeof(GlyphInstance));
+
+        batch.Destroy();
+        global::g_Allocator.destroyBuffer(buffer, allocation);
+        global::g_Allocator.destroyPool(pool);
+    }
+
+    // The glyph instance before packing, 56 bytes of 32 bit floats, kept only so -instancebench can compare the two layouts
+    struct UnpackedGlyphInstance
+    {
+        glm::vec2 center;
+        glm::vec2 size;
+        glm::vec4 uv;
+        glm::vec4 color;
+        float rotation;
+        float layer;
+    };
+
+    // Times one layout through the frame path: build every instance into the staging arena, then Commit into the chunks.
+    // Built from float attributes like the layout transform does, and copied from prebuilt instances like a layout cache hit does.
+    template<typename T, typename Build>
+    static void BenchmarkInstanceLayout(const char* name, vma::Pool pool, uint32_t instances, uint32_t frames, Build build)
+    {
+        const std::string label = std::string(name) + " (" + std::to_string(sizeof(T)) + " bytes, " + std::to_string(static_cast<uint64_t>(instances) * sizeof(T) / 1024) + " KB per frame)";
+        BenchmarkTimer timer(frames, instances);
+
+        InstanceBatch<T> batch;
+        batch.Init(pool);
+
+        timer.Start();
+        for (uint32_t frame = 0; frame < frames; ++frame)
+        {
+            T* staged = batch.Reserve(instances);
+            for (uint32_t i = 0; i < instances; ++i) staged[i] = build(i);
+
+            if (batch.Commit() != instances) IFX_ERROR("-instancebench could not allocate instance chunks");
+            batch.Clear();
+        }
+        timer.Stop();
+        timer.Report(label + ", built", "instance");
+
+        std::vector<T> cached(instances);
+        for (uint32_t i = 0; i < instances; ++i) cached[i] = build(i);
+
+        timer.Start();
+        for (uint32_t frame = 0; frame < frames; ++frame)
+        {
+            std::memcpy(batch.Reserve(instances), cached.data(), cached.size() * sizeof(T));
+
+            if (batch.Commit() != instances) IFX_ERROR("-instancebench could not allocate instance chunks");
+            batch.Clear();
+        }
+        timer.Stop();
+        timer.Report(label + ", cached", "instance");
+
+        batch.Destroy();
+    }
+
+    void BenchmarkInstanceLayouts(uint32_t instances, uint32_t frames)
+    {
+        struct Attributes
+        {
+            glm::vec2 center;
+            glm::vec2 size;
+            glm::vec4 uv;
+            glm::vec4 color;
+            float rotation;
+            uint32_t layer;
+        };
+
+        std::vector<Attributes> source(instances);
+        for (uint32_t i = 0; i < instances; ++i)
+        {
+            const float u = static_cast<float>(i % 20) * 0.05f;
+            source[i] = { glm::vec2(static_cast<float>(i % 160) * 12.f, static_cast<float>(i / 160) * 16.f), glm::vec2(12.f, 16.f), glm::vec4(u, 0.f, u + 0.05f, 0.05f),
+                glm::vec4(1.f, 0.5f, 0.25f, 1.f), static_cast<float>(i % 7) * 0.1f, i % 4 };
+        }
+
+        // Pool chunks sized for the larger layout, both batches allocate from it
+        vma::Pool pool = vkhelper::CreateBufferPool(sizeof(UnpackedGlyphInstance) * InstanceBatch<UnpackedGlyphInstance>::s_ChunkSize, vk::BufferUsageFlagBits::eVertexBuffer, vma::MemoryUsage::eAutoPreferHost, vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped, 0, global::g_Allocator);
+
+        IFX_INFO("Glyph instance layouts, {0} instances per frame over {1} frames", instances, frames);
+
+        BenchmarkInstanceLayout<UnpackedGlyphInstance>("unpacked", pool, instances, frames, [&source](uint32_t i)
+            {
+                const Attributes& a = source[i];
+                return UnpackedGlyphInstance{ a.center, a.size, a.uv, a.color, a.rotation, static_cast<float>(a.layer) };
+            });
+
+        BenchmarkInstanceLayout<GlyphInstance>("packed", pool, instances, frames, [&source](uint32_t i)
+            {
+                const Attributes& a = source[i];
+                return GlyphInstance::Pack(a.center, a.size, a.uv, a.color, a.rotation, a.layer);
+            });
+
+        global::g_Allocator.destroyPool(pool);
+    }
+
+    GlyphInstance GlyphInstance::Pack(glm::vec2 center, glm::vec2 size, glm::vec4 uv, glm::vec4 color, float rotation, uint32_t layer)
+    {
+        // Half floats lose precision quickly, keep animated angles near zero
+        rotation = std::remainder(rotation, glm::two_pi<float>());
+
+        GlyphInstance instance;
+        instance.center = center;
+        instance.size = size;
+        instance.uv[0] = PackUnorm16x2(uv.x, uv.y);
+        instance.uv[1] = PackUnorm16x2(uv.z, uv.w);
+        instance.color = glm::packUnorm4x8(color);
+        instance.rotation = static_cast<uint16_t>(glm::packHalf2x16(glm::vec2(rotation, 0.f)) & 0xFFFF);
+        instance.layer = static_cast<uint8_t>(layer);
+        instance.padding = 0;
+        return instance;
+    }
+
     void Renderer2D::Flush(vk::CommandBuffer cmd, const glm::mat4& projection)
 	{
-        //Atlas Draw
-        cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_vkAtlasPipeline);
-        
-		cmd.bindVertexBuffers(0, m_vkVertexBuffer, { 0UL });
-		cmd.bindIndexBuffer(m_vkIndexBuffer, { 0UL }, vk::IndexType::eUint32);
-        
-        cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_vkAtlasPipelineLayout, 0, { m_vkAtlasDescriptorSet }, {});
-        
+        InstanceBatch<GlyphInstance>& glyphs = m_GlyphBatches[m_Region];
+        InstanceBatch<RectInstance>& rects = m_RectBatches[m_Region];
+        InstanceBatch<ImageInstance>& images = m_ImageBatches[m_Region];
+
+        const uint32_t dropped = (glyphs.GetCount() - glyphs.Commit()) + (rects.GetCount() - rects.Commit()) + (images.GetCount() - images.Commit());
+        if (dropped > 0) IFX_WARN("Renderer2D out of instance memory, dropping {0} instances", dropped);
+
+        m_FrameStats.glyph_instances = glyphs.GetCount();
+        m_FrameStats.rect_instances = rects.GetCount();
+        m_FrameStats.image_instances = images.GetCount();
+        m_FrameStats.instance_bytes = glyphs.GetCount() * sizeof(GlyphInstance) + rects.GetCount() * sizeof(RectInstance) + images.GetCount() * sizeof(ImageInstance);
+        m_FrameStats.glyph_chunks = 0;
+        m_FrameStats.rect_chunks = 0;
+        m_FrameStats.image_chunks = 0;
+        m_FrameStats.staging_bytes = 0;
+        for (const auto& batch : m_GlyphBatches) { m_FrameStats.glyph_chunks += batch.GetChunkCount(); m_FrameStats.staging_bytes += batch.GetStagingBytes(); }
+        for (const auto& batch : m_RectBatches) { m_FrameStats.rect_chunks += batch.GetChunkCount(); m_FrameStats.staging_bytes += batch.GetStagingBytes(); }
+        for (const auto& batch : m_ImageBatches) { m_FrameStats.image_chunks += batch.GetChunkCount(); m_FrameStats.staging_bytes += batch.GetStagingBytes(); }
+        m_FrameStats.image_slots = static_cast<uint32_t>(m_ImageSlotIndices.size());
+
+        m_FrameStats.commands = static_cast<uint32_t>(m_Commands.size());
+        m_FrameStats.draw_calls = 0;
+        m_FrameStats.pipeline_binds = 0;
+        m_FrameStats.buffer_binds = 0;
+
+        RadixSort64(m_CommandKeys, m_SortScratch);
+
         Uniform uniform{};
         uniform.projection_view = projection;
         uniform.model = glm::mat4(1.f);
-        cmd.pushConstants<Uniform>(m_vkAtlasPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, uniform);
-        
-        cmd.drawIndexed(m_AtlasQuadCount * 6, 1, 0, 0, 0);
-        m_AtlasQuadCount = 0;
 
-        //Basic Draw
+        bool bound_any = false;
+        DrawPipeline bound_pipeline = DrawPipeline::Rect;
+        vk::Buffer bound_buffer = nullptr;
 
-        cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_vkQuadPipeline);
+        for (size_t i = 0; i < m_CommandKeys.size();)
+        {
+            const DrawCommand& command = m_Commands[m_CommandKeys[i] & 0xFFFFFFFF];
+            const uint64_t state = m_CommandKeys[i] & 0x0000FFFF00000000ULL;
 
-        cmd.bindVertexBuffers(0, m_vkBasicVertexBuffer, { 0UL });
-        cmd.bindIndexBuffer(m_vkIndexBuffer, { 0UL }, vk::IndexType::eUint32);
+            // Sorted neighbours with the same state whose instances follow on directly become one draw, across layers too
+            uint32_t count = command.count;
+            for (++i; i < m_CommandKeys.size(); ++i)
+            {
+                const DrawCommand& next = m_Commands[m_CommandKeys[i] & 0xFFFFFFFF];
+                if ((m_CommandKeys[i] & 0x0000FFFF00000000ULL) != state || next.first != command.first + count) break;
+                count += next.count;
+            }
 
-        //cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_vkQuadPipelineLayout, 0, { m_vkAtlasDescriptorSet }, {});
-        cmd.pushConstants<Uniform>(m_vkQuadPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, uniform);
+            if (!bound_any || bound_pipeline != command.pipeline)
+            {
+                if (command.pipeline == DrawPipeline::Glyph)
+                {
+                    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_vkAtlasPipeline);
+                    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_vkAtlasPipelineLayout, 0, { m_vkAtlasDescriptorSet }, {});
+                    cmd.pushConstants<Uniform>(m_vkAtlasPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, uniform);
+                }
+                else if (command.pipeline == DrawPipeline::Image)
+                {
+                    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_vkImagePipeline);
+                    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_vkImagePipelineLayout, 0, { m_vkImageDescriptorSet }, {});
+                    cmd.pushConstants<Uniform>(m_vkImagePipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, uniform);
+                }
+                else
+                {
+                    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_vkQuadPipeline);
+                    cmd.pushConstants<Uniform>(m_vkQuadPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, uniform);
+                }
 
-        cmd.drawIndexed(m_BasicQuadCount * 6, 1, 0, 0, 0);
-        m_BasicQuadCount = 0;
+                bound_any = true;
+                bound_pipeline = command.pipeline;
+                bound_buffer = nullptr;
+                ++m_FrameStats.pipeline_binds;
+            }
+
+            if (command.pipeline == DrawPipeline::Glyph) glyphs.Draw(cmd, command.first, count, bound_buffer, m_FrameStats);
+            else if (command.pipeline == DrawPipeline::Image) images.Draw(cmd, command.first, count, bound_buffer, m_FrameStats);
+            else rects.Draw(cmd, command.first, count, bound_buffer, m_FrameStats);
+        }
+
+        Discard();
 	}
 
+    void Renderer2D::Discard()
+    {
+        m_Commands.clear();
+        m_CommandKeys.clear();
+        m_Layer = 0;
+
+        m_GlyphBatches[m_Region].Clear();
+        m_ImageBatches[m_Region].Clear();
+        m_RectBatches[m_Region].Clear();
+    }
+
 	void Renderer2D::EndScene()
 	{
 
 	}
 
+    void Renderer2D::AddCommand(DrawPipeline pipeline, uint32_t texture, uint32_t first, uint32_t count)
+    {
+        if (count == 0) return;
+
+        const uint64_t state = (static_cast<uint64_t>(m_Layer) << 48) | (static_cast<uint64_t>(pipeline) << 44) | (static_cast<uint64_t>(texture & 0xFFF) << 32);
+
+        // Runs of the same state are extended in place, a page of FillRect calls stays one command
+        if (!m_CommandKeys.empty() && (m_CommandKeys.back() & 0xFFFFFFFF00000000ULL) == state)
+        {
+            DrawCommand& last = m_Commands.back();
+            if (last.first + last.count == first)
+            {
+                last.count += count;
+                return;
+            }
+        }
+
+        m_CommandKeys.push_back(state | m_Commands.size());
+        m_Commands.push_back({ pipeline, first, count });
+    }
+
+    uint64_t Renderer2D::NextFrame(uint64_t submit_serial)
+    {
+        m_RegionSerials[m_Region] = submit_serial;
+        ++m_SubmittedFrames;
+
+        m_Region = (m_Region + 1) % s_InstanceRegions;
+
+        return m_RegionSerials[m_Region];
+    }
+
     glm::vec2 Renderer2D::DrawString(const GraphicalString& str, glm::vec2 bounding_first, glm::vec2 bounding_second, int cursor)
+    {
+        const glm::vec2 origin(std::min(bounding_first.x, bounding_second.x), std::min(bounding_first.y, bounding_second.y));
+        const uint64_t key = LayoutKey(str, glm::abs(bounding_second - bounding_first), cursor, m_LayoutKeyScratch);
+
+        // Hit: the quads are copied as they were laid out, moved by one offset when the bounds moved
+        auto found = m_LayoutCache.find(key);
+        if (found != m_LayoutCache.end() && found->second.glyph_epoch == m_GlyphCache->GetEpoch() && found->second.key == m_LayoutKeyScratch)
+        {
+            CachedLayout& layout = found->second;
+            layout.last_used = m_Frame;
+            m_GlyphCache->Touch(layout.pages);
+            ++m_LayoutStats.hits;
+
+            const glm::vec2 offset = origin - layout.origin;
+            EmitGlyphInstances(layout.instances, offset);
+            return layout.result + offset;
+        }
+
+        ++m_LayoutStats.misses;
+
+        // First-use glyphs are rasterized together on the job system instead of one by one inside the layout loop
+        m_PrefetchScratch.clear();
+        for (int i = 0; i < str.Length(); ++i)
+        {
+            const char32_t ch = str[i].code;
+            if (ch == '\0') break;
+            if (ch == '\n') continue;
+            m_PrefetchScratch.emplace_back(static_cast<uint32_t>(str[i].font.fonttype), ch == '\t' ? U' ' : ch);
+        }
+        m_GlyphCache->Prefetch(m_PrefetchScratch);
+
+        m_GlyphRun.Clear();
+        uint32_t pages = 0;
+        bool complete = true;
+        const glm::vec2 result = LayoutString(str, bounding_first, bounding_second, cursor, m_GlyphRun, pages, complete);
+
+        // Layout is branchy and per glyph, the transform into instances is done for the whole run at once
+        m_LayoutScratch.resize(m_GlyphRun.Size());
+        if (m_GlyphRun.Size() > 0) GetGlyphKernels().transform(m_GlyphRun, m_LayoutScratch.data());
+        EmitGlyphInstances(m_LayoutScratch, glm::vec2(0.f));
+
+        // Layouts missing a glyph are not kept, the glyph may fit next frame
+        if (complete && (found != m_LayoutCache.end() || m_LayoutCache.size() < s_LayoutCacheCapacity))
+        {
+            CachedLayout& layout = m_LayoutCache[key];
+            layout.key = m_LayoutKeyScratch;
+            layout.instances = m_LayoutScratch;
+            layout.origin = origin;
+            layout.result = result;
+            layout.glyph_epoch = m_GlyphCache->GetEpoch();
+            layout.pages = pages;
+            layout.last_used = m_Frame;
+        }
+
+        return result;
+    }
+
+    void Renderer2D::EmitGlyphInstances(const std::vector<GlyphInstance>& instances, glm::vec2 offset)
+    {
+        if (instances.empty()) return;
+
+        InstanceBatch<GlyphInstance>& batch = m_GlyphBatches[m_Region];
+        const uint32_t first = batch.GetCount();
+        const uint32_t count = static_cast<uint32_t>(instances.size());
+
+        GlyphInstance* destination = batch.Reserve(count);
+        if (offset == glm::vec2(0.f))
+        {
+            std::memcpy(destination, instances.data(), count * sizeof(GlyphInstance));
+        }
+        else
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                destination[i] = instances[i];
+                destination[i].center += offset;
+            }
+        }
+
+        AddCommand(DrawPipeline::Glyph, 0, first, count);
+    }
+
+    // Fills key with everything the layout depends on (floats by their bits) and returns its hash
+    uint64_t Renderer2D::LayoutKey(const GraphicalString& str, glm::vec2 size, int cursor, std::vector<uint32_t>& key) const
+    {
+        auto push_floats = [&key](const float* values, size_t count)
+            {
+                const size_t at = key.size();
+                key.resize(at + count);
+                std::memcpy(key.data() + at, values, count * sizeof(float));
+            };
+
+        key.clear();
+        push_floats(&size.x, 1);
+        push_floats(&size.y, 1);
+        key.push_back(static_cast<uint32_t>(cursor));
+        key.push_back(static_cast<uint32_t>(str.Length()));
+
+        // Fonts are stored only where they change, most strings use one font throughout
+        float last_font[12] = {};
+        for (size_t i = 0; i < str.Length(); ++i)
+        {
+            key.push_back(static_cast<uint32_t>(str[i].code));
+
+            const Font& font = str[i].font;
+            const float fields[12] = {
+                static_cast<float>(font.fonttype), font.scale, font.fade, font.rotate_angle, font.char_rotate_angle,
+                font.translation.x, font.translation.y, font.translation.z,
+                font.color.r, font.color.g, font.color.b, font.color.a
+            };
+            // The flag word keeps the encoding unambiguous, two different strings never produce the same key
+            const bool changed = i == 0 || std::memcmp(fields, last_font, sizeof(fields)) != 0;
+            key.push_back(changed ? 1 : 0);
+            if (changed)
+            {
+                push_floats(fields, 12);
+                std::memcpy(last_font, fields, sizeof(fields));
+            }
+        }
+
+        return Fnv1a64(key.data(), key.size() * sizeof(uint32_t));
+    }
+
+    // Lays str out into run (one entry per glyph quad), pages collects the glyph cache pages sampled,
+    // complete turns false if a glyph had to be dropped
+    glm::vec2 Renderer2D::LayoutString(const GraphicalString& str, glm::vec2 bounding_first, glm::vec2 bounding_second, int cursor, GlyphRun& run, uint32_t& pages, bool& complete)
     {
         glm::vec2 position(std::min(bounding_first.x, bounding_second.x), std::min(bounding_first.y, bounding_second.y));
 
@@ -449,39 +955,57 @@ namespace saf {
         glm::vec2 localPosition = position;
         float firstchar = position.x;
         int lastspaceindex = 0;
-        int lastspacequadindex = m_AtlasQuadCount;
+        size_t lastspacequadindex = 0;
 
         int retries = 0;
+        const float font_size = m_GlyphCache->GetPixelHeight();
+
+        // Trig and packing only change with the font, not per glyph
+        GlyphStyle style;
+        glm::vec4 style_color(-1.f);
+        float style_angle = 0.f;
 
         for (int i = 0; i < str.Length(); ++i)
         {
-            char ch = str[i].code;
+            char32_t ch = str[i].code;
             if (ch == '\0') return cursor_pos;
 
             Font font = str[i].font;
 
             uint32_t ifontid = static_cast<uint32_t>(font.fonttype);
 
-            // Check if the charecter glyph is in the font atlas.
-            if (ch >= m_FontAtlas->m_FirstCode && ch <= m_FontAtlas->m_FirstCode + m_FontAtlas->m_NumOfCodes)
+            if (ch == '\n')
             {
-
-                // Retrive the data that is used to render a glyph of charecter 'ch'
-                stbtt_packedchar* packedChar = &(m_FontAtlas->m_PackedChars[ch - m_FontAtlas->m_FirstCode + m_FontAtlas->m_NumOfCodes * ifontid]);
-                stbtt_aligned_quad* alignedQuad = &(m_FontAtlas->m_AlignedQuads[ch - m_FontAtlas->m_FirstCode + m_FontAtlas->m_NumOfCodes * ifontid]);
-
-                // The units of the fields of the above structs are in pixels, 
+                // advance y by fontSize, reset x-coordinate
+                localPosition.y += font_size * font.scale;
+                localPosition.x = position.x;
+            }
+            else if (ch == '\t')
+            {
+                const Glyph* space = m_GlyphCache->Get(ifontid, ' ');
+                float tabwidth = (space ? space->xadvance : font_size) * font.scale * 4.f;
+                // Tab stops are relative to the bounds so a layout does not depend on where it is drawn
+                if (tabwidth > 0.f) localPosition.x = position.x + (floor((localPosition.x - position.x) / tabwidth) + 1.f) * tabwidth;
+            }
+            // Rasterized into the glyph cache on first use, nullptr only when the cache is out of room this frame
+            else if (const Glyph* glyph = m_GlyphCache->Get(ifontid, ch); !glyph)
+            {
+                complete = false;
+            }
+            else
+            {
+                // The units of the glyph metrics are in pixels, 
                 // convert them to a unit of what we want be multilplying to pixelScale  
                 glm::vec2 glyphSize =
                 {
-                    (packedChar->x1 - packedChar->x0) * font.scale,
-                    (packedChar->y1 - packedChar->y0) * font.scale
+                    glyph->width * font.scale,
+                    glyph->height * font.scale
                 };
 
                 glm::vec2 glyphBoundingBoxBottomLeft =
                 {
-                    packedChar->xoff * font.scale,
-                    (packedChar->yoff + m_FontAtlas->m_FontSize) * font.scale
+                    glyph->xoff * font.scale,
+                    (glyph->yoff + font_size) * font.scale
                 };
 
                 float char_right = localPosition.x + glyphBoundingBoxBottomLeft.x + glyphSize.x;
@@ -497,16 +1021,16 @@ namespace saf {
 
                         if (word_width < line_space)
                         {
-                            localPosition.y += m_FontAtlas->m_FontSize * font.scale;
+                            localPosition.y += font_size * font.scale;
                             localPosition.x = position.x;
-                            m_AtlasQuadCount = lastspacequadindex;
+                            run.Resize(lastspacequadindex);
 
                             i = lastspaceindex;
                             continue;
                         }
                         else
                         {
-                            localPosition.y += m_FontAtlas->m_FontSize * font.scale;
+                            localPosition.y += font_size * font.scale;
                             localPosition.x = position.x;
 
 
@@ -522,39 +1046,28 @@ namespace saf {
 
                 retries = 0;
 
-                uint32_t vertex_offs = m_AtlasQuadCount * 4;
-
-                //glm::mat4 scale = glm::scale(glm::mat4(1.f), glm::vec3(1.f, 1.f, 1.f));
-
-                glm::mat4 rotation = glm::rotate(glm::mat4(1.f), font.char_rotate_angle, glm::vec3(0.f, 0.f, 1.f));
-                //glm::mat3 rotation = glm::mat3(1.f);
-                glm::mat4 translation = glm::translate(glm::mat4(1.f), glm::vec3(localPosition.x + glyphSize.x / 2.f, localPosition.y + glyphSize.y / 2.f, 0.f) + font.translation);
-
-                m_VertexBuffer[vertex_offs + 0].pos = translation * rotation * glm::vec4(glyphBoundingBoxBottomLeft.x + glyphSize.x / 2.f, glyphBoundingBoxBottomLeft.y + glyphSize.y / 2.f, 0.f, 1.f);
-                m_VertexBuffer[vertex_offs + 1].pos = translation * rotation * glm::vec4(glyphBoundingBoxBottomLeft.x - glyphSize.x / 2.f, glyphBoundingBoxBottomLeft.y + glyphSize.y / 2.f, 0.f, 1.f);
-                m_VertexBuffer[vertex_offs + 2].pos = translation * rotation * glm::vec4(glyphBoundingBoxBottomLeft.x - glyphSize.x / 2.f, glyphBoundingBoxBottomLeft.y - glyphSize.y / 2.f, 0.f, 1.f);
-                m_VertexBuffer[vertex_offs + 3].pos = translation * rotation * glm::vec4(glyphBoundingBoxBottomLeft.x + glyphSize.x / 2.f, glyphBoundingBoxBottomLeft.y - glyphSize.y / 2.f, 0.f, 1.f);
-
-                m_VertexBuffer[vertex_offs + 0].tex_coord = glm::vec2(alignedQuad->s1, alignedQuad->t1);
-                m_VertexBuffer[vertex_offs + 1].tex_coord = glm::vec2(alignedQuad->s0, alignedQuad->t1);
-                m_VertexBuffer[vertex_offs + 2].tex_coord = glm::vec2(alignedQuad->s0, alignedQuad->t0);
-                m_VertexBuffer[vertex_offs + 3].tex_coord = glm::vec2(alignedQuad->s1, alignedQuad->t0);
+                const size_t quad_index = run.Size();
 
-                float fade = 1.f - font.fade;
-                m_VertexBuffer[vertex_offs + 0].color = font.color * fade;
-                m_VertexBuffer[vertex_offs + 1].color = font.color * fade;
-                m_VertexBuffer[vertex_offs + 2].color = font.color * fade;
-                m_VertexBuffer[vertex_offs + 3].color = font.color * fade;
+                // Whitespace has no bitmap and only advances the pen
+                if (glyph->HasBitmap())
+                {
+                    const glm::vec4 color = font.color * (1.f - font.fade);
+                    if (color != style_color || font.char_rotate_angle != style_angle)
+                    {
+                        style = GlyphStyle::Make(color, font.char_rotate_angle);
+                        style_color = color;
+                        style_angle = font.char_rotate_angle;
+                    }
 
-                float fontz = (static_cast<float>(font.fonttype) + 0.5f) / static_cast<float>(m_FontAtlas->m_NumOfFonts);
+                    // The quad is rotated around the pen position, which moves its center, then around its own center in the shader
+                    glm::vec2 pen = glm::vec2(localPosition.x + glyphSize.x / 2.f, localPosition.y + glyphSize.y / 2.f) + glm::vec2(font.translation);
+                    run.Push(pen, glyphBoundingBoxBottomLeft, glyphSize, glm::vec4(glyph->s0, glyph->t0, glyph->s1, glyph->t1), style, glyph->page);
 
-                m_VertexBuffer[vertex_offs + 0].samplerid = fontz;
-                m_VertexBuffer[vertex_offs + 1].samplerid = fontz;
-                m_VertexBuffer[vertex_offs + 2].samplerid = fontz;
-                m_VertexBuffer[vertex_offs + 3].samplerid = fontz;
+                    pages |= 1U << glyph->page;
+                }
 
-                // Update the position to render the next glyph specified by packedChar->xadvance.
-                localPosition.x += packedChar->xadvance * font.scale;
+                // Update the position to render the next glyph specified by glyph->xadvance.
+                localPosition.x += glyph->xadvance * font.scale;
 
                 if (i == cursor)
                 {
@@ -563,28 +1076,14 @@ namespace saf {
 
                 if (i > 0)
                 {
-                    char lastchar = str[i - 1].code;
+                    char32_t lastchar = str[i - 1].code;
                     if (lastchar == ' ' || lastchar == '\t' || lastchar == '\n')
                     {
                         firstchar = char_left;
                         lastspaceindex = i - 1;
-                        lastspacequadindex = m_AtlasQuadCount;
+                        lastspacequadindex = quad_index;
                     }
                 }
-
-                ++m_AtlasQuadCount;
-            }
-            else if (ch == '\n')
-            {
-                // advance y by fontSize, reset x-coordinate
-                localPosition.y += m_FontAtlas->m_FontSize * font.scale;
-                localPosition.x = position.x;
-            }
-            else if (ch == '\t')
-            {
-                stbtt_packedchar* packedChar = &(m_FontAtlas->m_PackedChars[' ' - m_FontAtlas->m_FirstCode + m_FontAtlas->m_NumOfCodes * ifontid]);
-                float tabwidth = (packedChar->x1 - packedChar->x0) * font.scale * 4.f;
-                localPosition.x = (floor(localPosition.x / tabwidth) + 1.f) * (m_FontAtlas->m_FontSize * font.scale * 4.f);
             }
         }
 
@@ -599,11 +1098,12 @@ namespace saf {
 
     glm::vec2 Renderer2D::DrawStringCenter(const GraphicalString& str, glm::vec2 bounding_first, glm::vec2 bounding_second, int cursor)
     {
-        uint32_t startquad = m_AtlasQuadCount;
+        InstanceBatch<GlyphInstance>& batch = m_GlyphBatches[m_Region];
+        uint32_t startquad = batch.GetCount();
         glm::vec2 endpos = DrawString(str, bounding_first, bounding_second, cursor);
-        for (int i = startquad * 4; i < m_AtlasQuadCount * 4; ++i)
+        for (uint32_t i = startquad; i < batch.GetCount(); ++i)
         {
-            m_VertexBuffer[i].pos -= (glm::vec3(endpos - bounding_first, 0.f) + glm::vec3(0.f, m_FontAtlas->m_FontSize * str[0].font.scale, 0.f)) / 2.f;
+            batch[i].center -= (endpos - bounding_first + glm::vec2(0.f, m_GlyphCache->GetPixelHeight() * str[0].font.scale)) / 2.f;
         }
         return (endpos + bounding_first) / 2.f;
     }
@@ -613,56 +1113,86 @@ namespace saf {
         return DrawStringCenter(GraphicalString(str, font), bounding_first, bounding_second, cursor);
     }
 
-    //void Renderer2D::DrawImage(std::shared_ptr<Image> image, glm::vec2 position)
-    //{
-    //    DrawImage(image, glm::translate(glm::mat4(1.f), glm::vec3(position.x, position.y, 0.f)));
-    //}
-    //
-    //void Renderer2D::DrawImage(std::shared_ptr<Image> image, glm::mat4 transform)
-    //{
-    //    int index = m_ImageList.size();
-    //    for (int i = 0; i < m_ImageList.size(); ++i)
-    //    {
-    //        if (m_ImageList[i] == image)
-    //        {
-    //            index = i;
-    //            break;
-    //        }
-    //    }
-    //    if (index = m_ImageList.size()) m_ImageList.push_back(image);
-    //
-    //
-    //    static glm::vec2 quad[4] = {
-    //        glm::vec2(+1.f, +1.f),
-    //        glm::vec2(-1.f, +1.f),
-    //        glm::vec2(-1.f, -1.f),
-    //        glm::vec2(+1.f, -1.f)
-    //    };
-    //
-    //    int vertexoffs = (m_MaxQuads - m_ImageQuadCount) * 4 - 1;
-    //    ++m_ImageQuadCount;
-    //
-    //    m_VertexBuffer[vertexoffs - 3].pos = glm::vec3(glm::vec4(quad[0], 0.f, 1.f) * transform);
-    //    m_VertexBuffer[vertexoffs - 2].pos = glm::vec3(glm::vec4(quad[1], 0.f, 1.f) * transform);
-    //    m_VertexBuffer[vertexoffs - 1].pos = glm::vec3(glm::vec4(quad[2], 0.f, 1.f) * transform);
-    //    m_VertexBuffer[vertexoffs - 0].pos = glm::vec3(glm::vec4(quad[3], 0.f, 1.f) * transform);
-    //
-    //    m_VertexBuffer[vertexoffs - 3].color = glm::vec4(1.f, 1.f, 1.f, 1.f);
-    //    m_VertexBuffer[vertexoffs - 2].color = glm::vec4(1.f, 1.f, 1.f, 1.f);
-    //    m_VertexBuffer[vertexoffs - 1].color = glm::vec4(1.f, 1.f, 1.f, 1.f);
-    //    m_VertexBuffer[vertexoffs - 0].color = glm::vec4(1.f, 1.f, 1.f, 1.f);
-    //
-    //    m_VertexBuffer[vertexoffs - 3].tex_coord = quad[0];
-    //    m_VertexBuffer[vertexoffs - 2].tex_coord = quad[1];
-    //    m_VertexBuffer[vertexoffs - 1].tex_coord = quad[2];
-    //    m_VertexBuffer[vertexoffs - 0].tex_coord = quad[3];
-    //
-    //    m_VertexBuffer[vertexoffs - 3].samplerid = static_cast<float>(index);
-    //    m_VertexBuffer[vertexoffs - 2].samplerid = static_cast<float>(index);
-    //    m_VertexBuffer[vertexoffs - 1].samplerid = static_cast<float>(index);
-    //    m_VertexBuffer[vertexoffs - 0].samplerid = static_cast<float>(index);
-    //}
-    //
+    void Renderer2D::DrawImage(const std::shared_ptr<Image>& image, glm::vec2 position, glm::vec2 size, glm::vec4 tint)
+    {
+        const uint32_t slot = GetImageSlot(image);
+        if (slot == UINT32_MAX) return;
+
+        InstanceBatch<ImageInstance>& batch = m_ImageBatches[m_Region];
+        ImageInstance* instance = batch.Push();
+        // Every image shares the one bindless set, so the key carries no texture and neighbours merge into one draw
+        AddCommand(DrawPipeline::Image, 0, batch.GetCount() - 1, 1);
+
+        instance->position = position;
+        instance->size = size;
+        instance->color = glm::packUnorm4x8(tint);
+        instance->texture = slot;
+    }
+
+    void Renderer2D::DrawImage(const std::shared_ptr<Image>& image, glm::vec2 position)
+    {
+        DrawImage(image, position, glm::vec2(image->GetWidth(), image->GetHeight()));
+    }
+
+    void Renderer2D::ReleaseImage(const std::shared_ptr<Image>& image)
+    {
+        auto found = m_ImageSlotIndices.find(image.get());
+        if (found == m_ImageSlotIndices.end()) return;
+
+        m_PendingImageReleases.push_back({ found->second, m_SubmittedFrames });
+        m_ImageSlotIndices.erase(found);
+    }
+
+    uint32_t Renderer2D::GetImageSlot(const std::shared_ptr<Image>& image)
+    {
+        auto found = m_ImageSlotIndices.find(image.get());
+        if (found != m_ImageSlotIndices.end()) return found->second;
+
+        uint32_t slot;
+        if (!m_FreeImageSlots.empty())
+        {
+            slot = m_FreeImageSlots.back();
+            m_FreeImageSlots.pop_back();
+        }
+        else if (m_ImageSlots.size() < s_MaxImages)
+        {
+            slot = static_cast<uint32_t>(m_ImageSlots.size());
+            m_ImageSlots.emplace_back();
+        }
+        else
+        {
+            IFX_WARN("Renderer2D image slots exhausted, release images that are no longer drawn");
+            return UINT32_MAX;
+        }
+
+        m_ImageSlots[slot] = image;
+        m_ImageSlotIndices[image.get()] = slot;
+
+        // No frame in flight reads this slot, the set is update after bind
+        vk::DescriptorImageInfo desc_image_info(m_vkImageSampler, image->GetImageView(), vk::ImageLayout::eShaderReadOnlyOptimal);
+        vk::WriteDescriptorSet desc_set_write(m_vkImageDescriptorSet, 0, slot, vk::DescriptorType::eCombinedImageSampler, desc_image_info);
+        global::g_Device.updateDescriptorSets(desc_set_write, {});
+
+        return slot;
+    }
+
+    void Renderer2D::ReleaseImageSlots()
+    {
+        // A release during frame N is safe to reuse once the region of frame N has been waited on for reuse
+        for (auto it = m_PendingImageReleases.begin(); it != m_PendingImageReleases.end();)
+        {
+            if (it->frame + s_InstanceRegions > m_SubmittedFrames)
+            {
+                ++it;
+                continue;
+            }
+
+            m_ImageSlots[it->slot].reset();
+            m_FreeImageSlots.push_back(it->slot);
+            it = m_PendingImageReleases.erase(it);
+        }
+    }
+
     //void DrawRect(glm::vec3 position, glm::vec2 size, glm::vec4 color = glm::vec4(1.f, 1.f, 1.f, 1.f))
     //{
     //
@@ -670,19 +1200,13 @@ namespace saf {
 
     void Renderer2D::FillRect(glm::vec3 position, glm::vec2 size, glm::vec4 color)
     {
+        InstanceBatch<RectInstance>& batch = m_RectBatches[m_Region];
+        RectInstance* instance = batch.Push();
+        AddCommand(DrawPipeline::Rect, 0, batch.GetCount() - 1, 1);
 
-        uint32_t vertex = m_BasicQuadCount * 4;
-        ++m_BasicQuadCount;
-
-        m_BasicVertexBuffer[vertex + 0].pos = glm::vec3(+size.x, +size.y, 0.f) + position;
-        m_BasicVertexBuffer[vertex + 1].pos = glm::vec3(0.f, +size.y, 0.f) + position;
-        m_BasicVertexBuffer[vertex + 2].pos = glm::vec3(0.f, 0.f, 0.f) + position;
-        m_BasicVertexBuffer[vertex + 3].pos = glm::vec3(+size.x, 0.f, 0.f) + position;
-
-        m_BasicVertexBuffer[vertex + 0].color = color;
-        m_BasicVertexBuffer[vertex + 1].color = color;
-        m_BasicVertexBuffer[vertex + 2].color = color;
-        m_BasicVertexBuffer[vertex + 3].color = color;
+        instance->position = glm::vec2(position);
+        instance->size = size;
+        instance->color = glm::packUnorm4x8(color);
     }
 
     void Renderer2D::FillRectCenter(glm::vec3 position, glm::vec2 size, glm::vec4 color)
@@ -1,13 +1,17 @@
 #pragma once
 
 #include "shader.h"
+#include "glyphcache.h"
+#include "glyphkernels.h"
+#include "image.h"
+#include "utils/utf8.h"
 
 #include <vk_mem_alloc.hpp>
 #include <vulkan/vulkan.hpp>
 #include <glm/glm.hpp>
-#include <stb_truetype.h>
-
+#include <array>
 #include <deque>
+#include <unordered_map>
 
 #include <stb_image.h>
 
@@ -15,45 +19,83 @@
 
 namespace saf {
 
-	struct Vertex {
-		glm::vec3 pos;
-		glm::vec4 color;
-		glm::vec2 tex_coord;
-		float samplerid;
+	// One glyph quad, the vertex shader expands it into two triangles (vkCmdDraw of 6 vertices per instance).
+	// Packed to 32 bytes, use Pack() rather than filling the fields by hand.
+	struct GlyphInstance {
+		glm::vec2 center;
+		glm::vec2 size;
+		uint32_t uv[2];		// s0, t0, s1, t1 as 16 bit unorm
+		uint32_t color;		// RGBA8 unorm
+		uint16_t rotation;	// half float radians around center, wrapped to [-pi, pi]
+		uint8_t layer;		// glyph cache page
+		uint8_t padding;
+
+		static GlyphInstance Pack(glm::vec2 center, glm::vec2 size, glm::vec4 uv, glm::vec4 color, float rotation, uint32_t layer);
 
 		inline static std::array<vk::VertexInputBindingDescription, 1> getBindingDescription() {
-			return { vk::VertexInputBindingDescription(0, sizeof(Vertex)) };
+			return { vk::VertexInputBindingDescription(0, sizeof(GlyphInstance), vk::VertexInputRate::eInstance) };
 		}
 
-		inline static std::array<vk::VertexInputAttributeDescription, 4> getAttributeDescription()
+		inline static std::array<vk::VertexInputAttributeDescription, 6> getAttributeDescription()
 		{
-			return std::array<vk::VertexInputAttributeDescription, 4>
+			return std::array<vk::VertexInputAttributeDescription, 6>
 			{
-				vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, pos)),
-				vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(Vertex, color)),
-				vk::VertexInputAttributeDescription(2, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, tex_coord)),
-				vk::VertexInputAttributeDescription(3, 0, vk::Format::eR32Sfloat, offsetof(Vertex, samplerid))
+				vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32Sfloat, offsetof(GlyphInstance, center)),
+				vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32Sfloat, offsetof(GlyphInstance, size)),
+				vk::VertexInputAttributeDescription(2, 0, vk::Format::eR16G16B16A16Unorm, offsetof(GlyphInstance, uv)),
+				vk::VertexInputAttributeDescription(3, 0, vk::Format::eR8G8B8A8Unorm, offsetof(GlyphInstance, color)),
+				vk::VertexInputAttributeDescription(4, 0, vk::Format::eR16Sfloat, offsetof(GlyphInstance, rotation)),
+				vk::VertexInputAttributeDescription(5, 0, vk::Format::eR8Uint, offsetof(GlyphInstance, layer))
 			};
 		}
 	};
+	static_assert(sizeof(GlyphInstance) == 32, "GlyphInstance must stay tightly packed");
 
-	struct BasicVertex {
-		glm::vec3 pos;
-		glm::vec4 color;
+	// One filled rectangle, expanded like GlyphInstance
+	struct RectInstance {
+		glm::vec2 position;	// corner with the smallest coordinates
+		glm::vec2 size;
+		uint32_t color;		// RGBA8 unorm
 
 		inline static std::array<vk::VertexInputBindingDescription, 1> getBindingDescription() {
-			return { vk::VertexInputBindingDescription(0, sizeof(BasicVertex)) };
+			return { vk::VertexInputBindingDescription(0, sizeof(RectInstance), vk::VertexInputRate::eInstance) };
 		}
 
-		inline static std::array<vk::VertexInputAttributeDescription, 2> getAttributeDescription()
+		inline static std::array<vk::VertexInputAttributeDescription, 3> getAttributeDescription()
 		{
-			return std::array<vk::VertexInputAttributeDescription, 2>
+			return std::array<vk::VertexInputAttributeDescription, 3>
 			{
-				vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(BasicVertex, pos)),
-				vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(BasicVertex, color)),
+				vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32Sfloat, offsetof(RectInstance, position)),
+				vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32Sfloat, offsetof(RectInstance, size)),
+				vk::VertexInputAttributeDescription(2, 0, vk::Format::eR8G8B8A8Unorm, offsetof(RectInstance, color)),
 			};
 		}
 	};
+	static_assert(sizeof(RectInstance) == 20, "RectInstance must stay tightly packed");
+
+	// One image quad, texture is the image's slot in the bindless image array
+	struct ImageInstance {
+		glm::vec2 position;	// top left corner
+		glm::vec2 size;
+		uint32_t color;		// RGBA8 unorm tint
+		uint32_t texture;
+
+		inline static std::array<vk::VertexInputBindingDescription, 1> getBindingDescription() {
+			return { vk::VertexInputBindingDescription(0, sizeof(ImageInstance), vk::VertexInputRate::eInstance) };
+		}
+
+		inline static std::array<vk::VertexInputAttributeDescription, 4> getAttributeDescription()
+		{
+			return std::array<vk::VertexInputAttributeDescription, 4>
+			{
+				vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32Sfloat, offsetof(ImageInstance, position)),
+				vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32Sfloat, offsetof(ImageInstance, size)),
+				vk::VertexInputAttributeDescription(2, 0, vk::Format::eR8G8B8A8Unorm, offsetof(ImageInstance, color)),
+				vk::VertexInputAttributeDescription(3, 0, vk::Format::eR32Uint, offsetof(ImageInstance, texture)),
+			};
+		}
+	};
+	static_assert(sizeof(ImageInstance) == 24, "ImageInstance must stay tightly packed");
 
 	struct Uniform {
 		glm::mat4 projection_view;
@@ -108,21 +150,22 @@ namespace saf {
 	{
 		struct GraphicalChar
 		{
-			GraphicalChar(char _code, Font _font = {})
+			GraphicalChar(char32_t _code, Font _font = {})
 				: code(_code), font(_font)
 			{
 
 			}
-			char code;
+			char32_t code;
 			Font font;
 		};
 
+		// str is UTF-8, one GraphicalChar per code point
 		GraphicalString(std::string str, Font font = Font(saf::FontType::ComicSans, 0.5f))
 		{
 			m_GChars.reserve(str.length());
-			for (char ch : str)
+			for (size_t index = 0; index < str.length();)
 			{
-				m_GChars.emplace_back(ch, font);
+				m_GChars.emplace_back(DecodeUtf8(str, index), font);
 			}
 		}
 
@@ -133,7 +176,7 @@ namespace saf {
 			std::string str = "";
 			for (const GraphicalChar& ch : m_GChars)
 			{
-				str += ch.code;
+				EncodeUtf8(ch.code, str);
 			}
 			return str;
 		}
@@ -151,92 +194,130 @@ namespace saf {
 		inline virtual bool ShouldDelete(float delta) { return false; }
 	};
 
-	class FontAtlas
+	struct LayoutCacheStats
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		size_t entries = 0;
+	};
+
+	// What the last Flush() sent to the GPU
+	struct FrameStats
+	{
+		uint32_t glyph_instances = 0;
+		uint32_t rect_instances = 0;
+		uint32_t image_instances = 0;
+		size_t instance_bytes = 0;
+		size_t staging_bytes = 0;	// cached staging arenas, over every frame in flight
+		uint32_t glyph_chunks = 0;	// chunks allocated, over every frame in flight
+		uint32_t rect_chunks = 0;
+		uint32_t image_chunks = 0;
+		uint32_t image_slots = 0;	// bindless slots in use
+		uint32_t commands = 0;
+		uint32_t draw_calls = 0;
+		uint32_t pipeline_binds = 0;
+		uint32_t buffer_binds = 0;
+	};
+
+	/*
+	 * Instances of one kind in fixed size chunks, each chunk a persistently mapped buffer from a VMA pool.
+	 * A frame that outgrows its chunks gets another one, chunks are kept for the frames after it.
+	 * Draw() issues one instanced draw per chunk in use.
+	 *
+	 * The chunks are write combined memory: scattered or partial writes and any read back are slow.
+	 * Instances are built and edited in a cached staging arena instead, Commit() streams them into the chunks
+	 * with one sequential copy per chunk before the frame is drawn.
+	 */
+	template<typename T>
+	class InstanceBatch
 	{
 	public:
-		FontAtlas(std::vector<std::string> files, int width, int height, int firstCode, int numofchars);
-		~FontAtlas();
-		FontAtlas(const FontAtlas&) = delete;
-		FontAtlas(FontAtlas&&) = delete;
-		FontAtlas& operator=(const FontAtlas&) = delete;
-		FontAtlas& operator=(FontAtlas&&) = delete;
+		static constexpr uint32_t s_ChunkSize = 0x4000; // instances
 
-		void Shutdown();
+		void Init(vma::Pool pool);
+		void Destroy();
 
-		inline const uint8_t* GetData() { return m_RawData; }
-		inline void Free()
-		{
-			if (m_RawData)
-			{
-				delete[] m_RawData;
-				m_RawData = nullptr;
-			}
-		}
-	private:
-		friend class Renderer2D;
+		// count instances at the end of the staging arena, valid until the next Reserve
+		T* Reserve(uint32_t count);
+		inline T* Push() { return Reserve(1); }
+
+		inline T& operator[](uint32_t index) { return m_Staging[index]; }
 
-		uint32_t m_Width, m_Height;
-		const float m_FontSize = 64.f;
-		int m_FirstCode;
-		int m_NumOfCodes;
-		int m_NumOfFonts;
+		inline uint32_t GetCount() const { return m_Count; }
+		inline uint32_t GetCommittedCount() const { return m_Committed; }
+		inline uint32_t GetChunkCount() const { return static_cast<uint32_t>(m_Chunks.size()); }
+		inline size_t GetStagingBytes() const { return m_Staging.size() * sizeof(T); }
+		inline void Clear() { m_Count = 0; m_Committed = 0; }
 
-		std::string m_File;
-		uint8_t* m_RawData;
-		stbtt_packedchar* m_PackedChars;
-		stbtt_aligned_quad* m_AlignedQuads;
+		// Copies the instances staged since the last Commit into the chunks, allocating chunks as needed.
+		// Returns the number of instances in the chunks, less than GetCount() when no chunk could be allocated.
+		uint32_t Commit();
 
-		vk::Image m_vkFontAtlas = nullptr;
-		vma::Allocation m_vmaFontAtlasAllocation = nullptr;
-		vk::ImageView m_vkFontAtlasView = nullptr;
+		// Draws instances [first, first + count), one draw per chunk touched, skipping any that were not committed.
+		// The pipeline using T must be bound, bound is the vertex buffer bound last and is only rebound when the chunk changes.
+		void Draw(vk::CommandBuffer cmd, uint32_t first, uint32_t count, vk::Buffer& bound, FrameStats& stats) const;
+
+	private:
+		struct Chunk
+		{
+			vk::Buffer buffer = nullptr;
+			vma::Allocation allocation = nullptr;
+			T* instances = nullptr;
+		};
 
+		std::vector<Chunk> m_Chunks;
+		std::vector<T> m_Staging; // only grows, m_Count is the part in use
+		uint32_t m_Count = 0;
+		uint32_t m_Committed = 0;
+		vma::Pool m_vmaPool = nullptr;
 	};
 
-	//struct Image
-	//{
-	//	Image(std::string file)
-	//	{
-	//		vk::ImageCreateInfo image_info;
-	//		vk::ImageCreateFlagBits::
-	//		//vkhelper::CreateImage();
-	//	}
-	//
-	//	~Image()
-	//	{
-	//		global::g_Device.destroyImageView(m_vkImageView);
-	//		global::g_Allocator.destroyImage(m_vkImage, m_vmaAllocation);
-	//	}
-	//
-	//	Image(const Image&) = delete;
-	//	Image(Image&&) = delete;
-	//	Image& operator=(const Image&) = delete;
-	//	Image& operator=(Image&&) = delete;
-	//
-	//	vk::Image m_vkImage;
-	//	vk::ImageView m_vkImageView;
-	//	vma::Allocation m_vmaAllocation;
-	//};
+	// Times building instances straight in write combined memory (field by field, with a read back like DrawStringCenter)
+	// against the staging arena and one copy, instances per frame over frames. Needs global::g_Allocator.
+	void BenchmarkInstanceStaging(uint32_t instances, uint32_t frames);
+
+	// Times the packed 32 byte GlyphInstance against the 56 byte float layout it replaced, built and copied through an InstanceBatch.
+	void BenchmarkInstanceLayouts(uint32_t instances, uint32_t frames);
 
 	class Renderer2D
 	{
 	public:
-		Renderer2D();
+		Renderer2D(GlyphMode glyph_mode = GlyphMode::SDF);
 
 		void Init();
 		void Shutdown();
 		void BeginScene();
 		void Submit();
+		// defer runs work once the submit cmd belongs to has completed, see GlyphCache::Upload
+		void Upload(vk::CommandBuffer cmd, uint32_t frame, const GlyphCache::DeferFn& defer);
 		void Flush(vk::CommandBuffer cmd, const glm::mat4& projection);
+		// Drops everything drawn since the last Flush, for frames that end without one (no swapchain image to render to)
+		void Discard();
 		void EndScene();
 
+		// Called once the frame that flushed the current instance region is submitted as submit_serial.
+		// Moves on to the next region and returns the submit serial that must complete before it is written, 0 if none.
+		uint64_t NextFrame(uint64_t submit_serial);
+
 		glm::vec2 DrawString(const GraphicalString& str, glm::vec2 bounding_first = { -1.f, -1.f }, glm::vec2 bounding_second = { 1.f, 1.f }, int cursor = -1);
 		glm::vec2 DrawString(const std::string& str, glm::vec2 bounding_first = { -1.f, -1.f }, glm::vec2 bounding_second = { 1.f, 1.f }, int cursor = -1, Font font = Font(saf::FontType::ComicSans, 0.5f));
 
 		glm::vec2 DrawStringCenter(const GraphicalString& str, glm::vec2 bounding_first = { -1.f, -1.f }, glm::vec2 bounding_second = { 1.f, 1.f }, int cursor = -1);
 		glm::vec2 DrawStringCenter(const std::string& str, glm::vec2 bounding_first = { -1.f, -1.f }, glm::vec2 bounding_second = { 1.f, 1.f }, int cursor = -1, Font font = Font(saf::FontType::ComicSans, 0.5f));
 
-		//void DrawImage(std::shared_ptr<Image> image, glm::vec2 position);
-		//void DrawImage(std::shared_ptr<Image> image, glm::mat4 transform);
+		inline const LayoutCacheStats& GetLayoutCacheStats() const { return m_LayoutStats; }
+		inline const FrameStats& GetFrameStats() const { return m_FrameStats; }
+
+		// Draws on a higher layer are drawn over lower ones, within a layer rects go under images and images under text.
+		// Applies to everything drawn until it is changed again, starts out at 0 every frame.
+		inline void SetLayer(uint16_t layer) { m_Layer = layer; }
+		inline uint16_t GetLayer() const { return m_Layer; }
+
+		// Images get a slot in one bindless array on first draw, every image on a layer draws with a single call.
+		// The renderer holds on to the image until ReleaseImage, the slot is reused once no frame in flight reads it.
+		void DrawImage(const std::shared_ptr<Image>& image, glm::vec2 position, glm::vec2 size, glm::vec4 tint = glm::vec4(1.f, 1.f, 1.f, 1.f));
+		void DrawImage(const std::shared_ptr<Image>& image, glm::vec2 position);
+		void ReleaseImage(const std::shared_ptr<Image>& image);
 
 		//void DrawRect(glm::vec3 position, glm::vec2 size, glm::vec4 color = glm::vec4(1.f, 1.f, 1.f, 1.f));
 		//void DrawRect(glm::vec3 position, glm::vec2 size, glm::vec4 color = glm::vec4(1.f, 1.f, 1.f, 1.f));
@@ -248,28 +329,93 @@ namespace saf {
 
 		/* DrawCalls
 		 *
-		 * Pipeline
-			 * Aligned Rect, Image2DArray FontAtlas + ImageAtlas (512x512xN)	| Common Vertex / Index Buffers
-			 * Bind Descriptors, Bind VertexBuffer, Bind IndexBuffer			| Common Vertex / Index Buffers
-			 * Set ImageAttachment MemoryBarrier, DrawCMD						| Common Vertex / Index Buffers
-		 * Pipeline																| Common Vertex / Index Buffers
-			 * Aligned Rect, Image2DArray Small (256x256)xN						| Common Vertex / Index Buffers
-			 * Bind Descriptors, Bind VertexBuffer, Bind IndexBuffer			| Common Vertex / Index Buffers
-			 * Set ImageAttachment MemoryBarrier, DrawCMD						| Common Vertex / Index Buffers
-		 * Pipeline																| Common Vertex / Index Buffers
-			 * Aligned Rect, Image2DArray Large (1024x1024)xN					| Common Vertex / Index Buffers
-			 * Bind Descriptors, Bind VertexBuffer, Bind IndexBuffer			| Common Vertex / Index Buffers
-			 * Set ImageAttachment MemoryBarrier, DrawCMD						| Common Vertex / Index Buffers
-		 * Pipeline
-		 * 
+		 * Every draw is one instanced quad per rect, image or glyph, instances come from the region's chunked instance buffers.
+		 * Commands are radix sorted by layer, pipeline and texture, neighbours with the same state and adjacent instances merge into one draw.
+		 *
+		 * Pipeline Glyph		| GlyphCache pages, one R8 Image2DArray (1024x1024 per layer, grows up to 16 layers), one set
+		 *						| per image, a grown image gets a new set and the old one is freed with it once no frame uses it
+		 * Pipeline Image		| Bindless array of s_MaxImages combined image samplers, update after bind, one set for all images,
+		 *						| the instance carries its slot, slots are released once the frames that drew them are done
+		 * Pipeline Rect		| No descriptors, color only
+		 *
 		 * Pipeline						TODO
 			 * Filled TriangleMesh		TODO
 			 *							TODO
 			 * Lines					TODO
-		 * 
+		 *
 		 */
 
 	private:
+		/*
+		 * DrawString results keyed by text, fonts, bound size and cursor.
+		 * The map is keyed by a hash of that key material, the material itself is kept and compared on a hit so a collision is a miss.
+		 * Instances are stored as laid out at origin, a hit at other bounds of the same size only adds an offset.
+		 * Evicting a glyph cache page changes the glyph epoch, which invalidates every layout.
+		 */
+		struct CachedLayout
+		{
+			std::vector<uint32_t> key;
+			std::vector<GlyphInstance> instances;
+			glm::vec2 origin;
+			glm::vec2 result;
+			uint64_t glyph_epoch;
+			uint32_t pages;
+			uint64_t last_used;
+		};
+
+		/*
+		 * Every draw records a command, Flush() radix sorts them and merges neighbours into as few draws as possible.
+		 *
+		 *   63          48 47      44 43       32 31          0
+		 *   | layer       | pipeline | texture   | sequence    |
+		 *
+		 * The sequence is the command index, it keeps submission order among equal state and finds the command again.
+		 */
+		enum class DrawPipeline : uint8_t
+		{
+			Rect = 0,
+			Image = 1,
+			Glyph = 2
+		};
+
+		struct DrawCommand
+		{
+			DrawPipeline pipeline;
+			uint32_t first;
+			uint32_t count;
+		};
+
+		void AddCommand(DrawPipeline pipeline, uint32_t texture, uint32_t first, uint32_t count);
+
+		static constexpr uint32_t s_MaxImages = 1024;
+
+		struct PendingImageRelease
+		{
+			uint32_t slot;
+			uint64_t frame;
+		};
+
+		uint32_t GetImageSlot(const std::shared_ptr<Image>& image);
+		void ReleaseImageSlots();
+
+		std::vector<DrawCommand> m_Commands;
+		std::vector<uint64_t> m_CommandKeys;
+		std::vector<uint64_t> m_SortScratch;
+		uint16_t m_Layer = 0;
+
+		glm::vec2 LayoutString(const GraphicalString& str, glm::vec2 bounding_first, glm::vec2 bounding_second, int cursor, GlyphRun& run, uint32_t& pages, bool& complete);
+		uint64_t LayoutKey(const GraphicalString& str, glm::vec2 size, int cursor, std::vector<uint32_t>& key) const;
+		void EmitGlyphInstances(const std::vector<GlyphInstance>& instances, glm::vec2 offset);
+
+		std::unordered_map<uint64_t, CachedLayout> m_LayoutCache;
+		GlyphRun m_GlyphRun;
+		std::vector<GlyphInstance> m_LayoutScratch;
+		std::vector<uint32_t> m_LayoutKeyScratch;
+		std::vector<std::pair<uint32_t, char32_t>> m_PrefetchScratch;
+		LayoutCacheStats m_LayoutStats;
+		FrameStats m_FrameStats;
+		uint64_t m_Frame = 0;
+
 		vk::PipelineLayout m_vkAtlasPipelineLayout = nullptr;
 		vk::Pipeline m_vkAtlasPipeline = nullptr;
 
@@ -283,28 +429,37 @@ namespace saf {
 		vk::PipelineLayout m_vkQuadPipelineLayout = nullptr;
 		vk::Pipeline m_vkQuadPipeline = nullptr;
 
-		const uint32_t m_MaxQuads = 0x4000;
-		uint32_t m_AtlasQuadCount = 0;
-		uint32_t m_BasicQuadCount = 0;
-
-		Vertex* m_VertexBuffer = nullptr;
-		BasicVertex* m_BasicVertexBuffer = nullptr;
-
-		vma::Allocation m_vmaVertexAllocation = nullptr;
-		vk::Buffer m_vkVertexBuffer = nullptr;
-		vma::Allocation m_vmaBasicVertexAllocation = nullptr;
-		vk::Buffer m_vkBasicVertexBuffer = nullptr;
-
-		vma::Allocation m_vmaIndexAllocation = nullptr;
-		vk::Buffer m_vkIndexBuffer = nullptr;
+		static constexpr uint32_t s_InstanceRegions = 3;
+		static constexpr vk::DeviceSize s_InstancePoolBlockSize = 4 * 1024 * 1024;
+
+		// One pair of batches per region, the current region is the one being filled
+		vma::Pool m_vmaInstancePool = nullptr;
+		std::array<InstanceBatch<GlyphInstance>, s_InstanceRegions> m_GlyphBatches;
+		std::array<InstanceBatch<RectInstance>, s_InstanceRegions> m_RectBatches;
+		std::array<InstanceBatch<ImageInstance>, s_InstanceRegions> m_ImageBatches;
+		uint32_t m_Region = 0;
+		uint64_t m_SubmittedFrames = 0;
+		std::array<uint64_t, s_InstanceRegions> m_RegionSerials{};
+
+		vk::PipelineLayout m_vkImagePipelineLayout = nullptr;
+		vk::Pipeline m_vkImagePipeline = nullptr;
+		vk::DescriptorPool m_vkImageDescriptorPool = nullptr;
+		vk::DescriptorSetLayout m_vkImageDescriptorSetLayout = nullptr;
+		vk::DescriptorSet m_vkImageDescriptorSet = nullptr;
+		vk::Sampler m_vkImageSampler = nullptr;
+
+		std::vector<std::shared_ptr<Image>> m_ImageSlots;
+		std::unordered_map<const Image*, uint32_t> m_ImageSlotIndices;
+		std::vector<uint32_t> m_FreeImageSlots;
+		std::vector<PendingImageRelease> m_PendingImageReleases;
 
 		vk::DescriptorSetLayout m_vkAtlasDescriptorSetLayout = nullptr;
 		vk::DescriptorSet m_vkAtlasDescriptorSet = nullptr;
 		vk::Sampler m_vkAtlasSampler = nullptr;
 
-		std::shared_ptr<FontAtlas> m_FontAtlas;
-
-		//std::vector<std::shared_ptr<Image>> m_ImageList;
+		GlyphMode m_GlyphMode;
+		std::shared_ptr<GlyphCache> m_GlyphCache;
+		vk::ImageView m_vkBoundGlyphView = nullptr;
 
 		friend class FrameManager;
 	};
@@ -44,20 +44,23 @@ namespace saf {
 
         auto& unnamed = m_JSON["unnamed"];
 
+        // Flags without arguments (e.g. -gpu) are stored as an empty array so contains() still finds them
+        auto flush = [this, &current_parameter, &current_arguments]()
+            {
+                if (current_parameter == "") return;
+                if (current_arguments.size() == 0) m_RunArguments[current_parameter] = json::array();
+                else if (current_arguments.size() == 1) m_RunArguments[current_parameter] = current_arguments[0];
+                else m_RunArguments[current_parameter] = current_arguments;
+                current_arguments.clear();
+            };
+
         for (int i = 0; i < argc; ++i)
         {
             auto str = std::string(argsv[i]);
             if (str.starts_with('-'))
             {
-                str = str.substr(1, str.size() - 1);
-                if (current_parameter != "")
-                {
-                    if (current_arguments.size() == 0) m_RunArguments.emplace_back(current_parameter);
-                    else if (current_arguments.size() == 1) m_RunArguments[current_parameter] = current_arguments[0];
-                    else m_RunArguments[current_parameter] = current_arguments;
-                }
-                current_parameter = str;
-                current_arguments.clear();
+                flush();
+                current_parameter = str.substr(1, str.size() - 1);
             }
             else
             {
@@ -67,15 +70,10 @@ namespace saf {
                     else IFX_ERROR("ArgumentManager, too many unnamed arguments given, discarding \"{0}\"", str);
                 }
                 else current_arguments.emplace_back(str);
-
-                if (i == argc - 1 && current_parameter != "")
-                {
-                    if (current_arguments.size() == 1) m_RunArguments[current_parameter] = current_arguments[0];
-                    else m_RunArguments[current_parameter] = current_arguments;
-                    current_arguments.clear();
-                }
             }
         }
+
+        flush();
     }
 
     //Ensures that m_RunArguments only contains arguments defined in m_JSON (assets/params.json)
@@ -122,4 +120,20 @@ namespace saf {
 
     }
 
+    uint32_t GetUIntArgument(const json& args, const char* name, uint32_t fallback)
+    {
+        if (!args.contains(name)) return fallback;
+
+        const auto& value = args[name];
+        try
+        {
+            const long long result = value.is_number_integer() ? value.get<long long>() : std::stoll(value.get<std::string>());
+            if (result > 0 && result <= UINT32_MAX) return static_cast<uint32_t>(result);
+        }
+        catch (const std::exception&) {}
+
+        IFX_ERROR("-{0} expects a positive integer, got {1}", name, value.dump());
+        return fallback;
+    }
+
 }
\ No newline at end of file
@@ -20,4 +20,8 @@ namespace saf {
         json m_JSON;
     };
 
+    // Positive integer run argument args[name], from the command line (a string) or a JSON integer.
+    // fallback when it is not given, anything else that is not a positive 32 bit integer is an error.
+    uint32_t GetUIntArgument(const json& args, const char* name, uint32_t fallback = 0);
+
 }
\ No newline at end of file
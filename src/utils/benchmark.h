@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <stdint.h>
+
+namespace saf {
+
+    // Wall time of one benchmark pass repeated over frames frames of items items each, shared by the -*bench command line options
+    class BenchmarkTimer
+    {
+    public:
+        using Clock = std::chrono::high_resolution_clock;
+
+        BenchmarkTimer(uint32_t frames, uint64_t items) : m_Frames(frames), m_Items(items) {}
+
+        inline void Start() { m_Start = Clock::now(); }
+        inline void Stop() { m_Seconds = std::chrono::duration<double>(Clock::now() - m_Start).count(); }
+
+        // Logs the last Start() to Stop() as "\t<name>: <us> us per frame, <ns> ns per <item>", with the throughput in GB/s when bytes_per_item is given
+        void Report(const std::string& name, const char* item, size_t bytes_per_item = 0) const
+        {
+            const double us_per_frame = m_Seconds * 1e6 / m_Frames;
+            const double ns_per_item = m_Seconds * 1e9 / (static_cast<double>(m_Frames) * m_Items);
+            if (bytes_per_item == 0) IFX_INFO("\t{0}: {1:.1f} us per frame, {2:.2f} ns per {3}", name, us_per_frame, ns_per_item, item);
+            else IFX_INFO("\t{0}: {1:.1f} us per frame, {2:.2f} ns per {3}, {4:.2f} GB/s", name, us_per_frame, ns_per_item, item, bytes_per_item / ns_per_item);
+        }
+
+    private:
+        uint32_t m_Frames;
+        uint64_t m_Items;
+        Clock::time_point m_Start{};
+        double m_Seconds = 0.0;
+    };
+
+}
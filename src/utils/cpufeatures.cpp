@@ -0,0 +1,77 @@
+#include "safpch.h"
+#include "cpufeatures.h"
+
+#ifdef SAF_X86
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+namespace saf {
+
+#ifdef SAF_X86
+    static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+    {
+    #if defined(_MSC_VER)
+        int r[4];
+        __cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+        for (int i = 0; i < 4; ++i) regs[i] = static_cast<uint32_t>(r[i]);
+    #else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+    #endif
+    }
+
+    static uint64_t xgetbv0()
+    {
+    #if defined(_MSC_VER)
+        return _xgetbv(0);
+    #else
+        uint32_t eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<uint64_t>(edx) << 32) | eax;
+    #endif
+    }
+
+    static CpuFeatures QueryCpuFeatures()
+    {
+        CpuFeatures features{};
+
+        uint32_t regs[4];
+        cpuid(0, 0, regs);
+        const uint32_t max_leaf = regs[0];
+        if (max_leaf < 1) return features;
+
+        cpuid(1, 0, regs);
+        features.sse41 = (regs[2] & (1U << 19)) != 0;
+
+        const bool osxsave = (regs[2] & (1U << 27)) != 0;
+        const bool avx = (regs[2] & (1U << 28)) != 0;
+        if (!osxsave || !avx || max_leaf < 7) return features;
+
+        const uint64_t xcr0 = xgetbv0();
+        const bool os_avx = (xcr0 & 0x6) == 0x6;        // XMM | YMM state
+        const bool os_avx512 = (xcr0 & 0xE6) == 0xE6;   // XMM | YMM | opmask | ZMM state
+
+        cpuid(7, 0, regs);
+        features.avx2 = os_avx && (regs[1] & (1U << 5)) != 0;
+        features.avx512f = os_avx512 && (regs[1] & (1U << 16)) != 0;
+        features.avx512bw = features.avx512f && (regs[1] & (1U << 30)) != 0;
+
+        return features;
+    }
+#else
+    static CpuFeatures QueryCpuFeatures()
+    {
+        return {};
+    }
+#endif
+
+    const CpuFeatures& GetCpuFeatures()
+    {
+        static const CpuFeatures features = QueryCpuFeatures();
+        return features;
+    }
+
+}
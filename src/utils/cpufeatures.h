@@ -0,0 +1,27 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SAF_X86 1
+#endif
+
+// Lets a single function use instructions beyond the compiler baseline, callers must check GetCpuFeatures() first.
+#if defined(_MSC_VER) && !defined(__clang__)
+    #define SAF_TARGET(x)
+#else
+    #define SAF_TARGET(x) __attribute__((target(x)))
+#endif
+
+namespace saf {
+
+    struct CpuFeatures
+    {
+        bool sse41 = false;
+        bool avx2 = false;
+        bool avx512f = false;
+        bool avx512bw = false;
+    };
+
+    // Queried once through CPUID, includes the OS check (XGETBV) for AVX / AVX-512 register state.
+    const CpuFeatures& GetCpuFeatures();
+
+}
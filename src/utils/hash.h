@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace saf {
+
+    static constexpr uint64_t s_Fnv1aOffset = 0xcbf29ce484222325ULL;
+    static constexpr uint64_t s_Fnv1aPrime = 0x100000001b3ULL;
+
+    // 64 bit FNV-1a, pass a previous result as seed to hash several buffers as one.
+    inline uint64_t Fnv1a64(const void* data, size_t size, uint64_t seed = s_Fnv1aOffset)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= s_Fnv1aPrime;
+        }
+        return hash;
+    }
+
+}
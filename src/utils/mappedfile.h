@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace saf {
+
+    // Read only memory mapping of a whole file, unmapped on Close() / destruction.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile(MappedFile&&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&&) = delete;
+        ~MappedFile();
+
+        bool Open(const std::string& path);
+        void Close();
+
+        inline bool IsOpen() const { return m_Data != nullptr; }
+        inline const uint8_t* GetData() const { return m_Data; }
+        inline size_t GetSize() const { return m_Size; }
+
+    private:
+        const uint8_t* m_Data = nullptr;
+        size_t m_Size = 0;
+
+#ifdef _WIN32
+        void* m_File = nullptr;
+        void* m_Mapping = nullptr;
+#endif
+    };
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace saf {
+
+    // Ascending LSD radix sort of 64 bit keys, a byte per pass. Passes where every key has the same byte are skipped,
+    // so keys that only differ in a few fields cost only those passes. scratch is resized to keys.size().
+    inline void RadixSort64(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch)
+    {
+        if (keys.size() < 64)
+        {
+            std::sort(keys.begin(), keys.end());
+            return;
+        }
+
+        scratch.resize(keys.size());
+        for (uint32_t shift = 0; shift < 64; shift += 8)
+        {
+            size_t offsets[256] = {};
+            for (uint64_t key : keys) ++offsets[(key >> shift) & 0xFF];
+            if (offsets[(keys[0] >> shift) & 0xFF] == keys.size()) continue;
+
+            size_t offset = 0;
+            for (size_t& count : offsets)
+            {
+                const size_t bucket = count;
+                count = offset;
+                offset += bucket;
+            }
+
+            for (uint64_t key : keys) scratch[offsets[(key >> shift) & 0xFF]++] = key;
+            keys.swap(scratch);
+        }
+    }
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace saf {
+
+    static constexpr char32_t s_Utf8Replacement = 0xFFFD;
+
+    // Decodes the code point starting at str[index] and advances index past it.
+    // Malformed, overlong or surrogate sequences decode to U+FFFD and skip a single byte.
+    inline char32_t DecodeUtf8(const std::string& str, size_t& index)
+    {
+        const uint8_t lead = static_cast<uint8_t>(str[index++]);
+        if (lead < 0x80) return lead;
+
+        uint32_t length = 0;
+        char32_t code = 0;
+        if ((lead & 0xE0) == 0xC0) { length = 1; code = lead & 0x1F; }
+        else if ((lead & 0xF0) == 0xE0) { length = 2; code = lead & 0x0F; }
+        else if ((lead & 0xF8) == 0xF0) { length = 3; code = lead & 0x07; }
+        else return s_Utf8Replacement;
+
+        if (index + length > str.size()) return s_Utf8Replacement;
+
+        for (uint32_t i = 0; i < length; ++i)
+        {
+            const uint8_t next = static_cast<uint8_t>(str[index + i]);
+            if ((next & 0xC0) != 0x80) return s_Utf8Replacement;
+            code = (code << 6) | (next & 0x3F);
+        }
+
+        static constexpr char32_t minimum[4] = { 0, 0x80, 0x800, 0x10000 };
+        if (code < minimum[length] || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) return s_Utf8Replacement;
+
+        index += length;
+        return code;
+    }
+
+    inline void EncodeUtf8(char32_t code, std::string& out)
+    {
+        if (code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) code = s_Utf8Replacement;
+
+        if (code < 0x80)
+        {
+            out += static_cast<char>(code);
+        }
+        else if (code < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+}